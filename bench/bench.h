@@ -0,0 +1,287 @@
+#ifndef _BENCH_H_DEFINED_
+#define _BENCH_H_DEFINED_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+//***********************************************************************
+//
+// Benchmark harness
+//
+// Each scenario is a callable that performs one repetition of work over
+// `items` units (bytes, requests, handoffs...). run_bench runs it
+// `warmup` times untimed, then `reps` times timed, and records the wall
+// time of each repetition plus, where perf_event_open is permitted,
+// hardware counters summed over the timed repetitions. Results are
+// written as JSON so runs can be compared over time.
+//
+//***********************************************************************
+
+struct bench_config {
+    int warmup = 2;
+    int reps = 10;
+    std::string filter;    // Only run scenarios whose name contains this
+};
+
+// Hardware counters gathered for a scenario, totalled over all timed
+// repetitions. `available` is false when perf_event_open is not
+// permitted (containers, perf_event_paranoid) or not supported.
+// `inherited` is true when threads the scenario started were counted
+// too, and false when only the calling thread was.
+struct bench_counters {
+    bool available = false;
+    bool inherited = false;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    uint64_t branch_misses = 0;
+};
+
+struct bench_result {
+    std::string name;
+    std::string unit;              // What one item is, e.g. "bytes"
+    uint64_t items = 0;            // Items processed per repetition
+    std::vector<double> ns;        // Wall time of each timed repetition
+    bench_counters counters;
+};
+
+//***********************************************************************
+//
+// perf_group
+//
+// A perf_event_open counter group for the calling thread: cycles (the
+// leader), instructions, cache misses and branch misses. The group is
+// scheduled onto the PMU as a unit, so when the kernel multiplexes
+// counters all four still cover the same time, and ratios such as IPC
+// are meaningful. The counts are scaled up by enabled/running time.
+//
+// With inherit, threads created after the group is opened are counted
+// too, but threads that already existed are not. A scenario that uses
+// long-lived threads (e.g. an executor pool) has to open its group
+// before starting them. Kernels that refuse inherit on a group get a
+// calling-thread-only group instead. Opening fails quietly and leaves
+// the group unavailable.
+//
+//***********************************************************************
+class perf_group {
+public:
+    perf_group() {
+        if (!open(true)) open(false);
+    }
+
+    perf_group(const perf_group&) = delete;
+    perf_group& operator=(const perf_group&) = delete;
+
+    ~perf_group() { close_all(); }
+
+    bool available() const { return fds_[0] >= 0; }
+
+    void start() {
+        if (available()) ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void stop() {
+        if (available()) ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // Read and reset the counters into `out`.
+    void collect(bench_counters& out) {
+        if (!available()) return;
+        // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, then
+        // one value per event in the order they were opened.
+        uint64_t data[3 + 4];
+        if (read(fds_[0], data, sizeof(data)) != sizeof(data) || data[0] != 4) return;
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        double scale = data[2] > 0 && data[2] < data[1] ? (double)data[1] / data[2] : 1.0;
+        out.available = true;
+        out.inherited = inherit_;
+        out.cycles = (uint64_t)(data[3] * scale);
+        out.instructions = (uint64_t)(data[4] * scale);
+        out.cache_misses = (uint64_t)(data[5] * scale);
+        out.branch_misses = (uint64_t)(data[6] * scale);
+    }
+
+private:
+    bool open(bool inherit) {
+        static const uint64_t events[4] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+        };
+        for (int i = 0; i < 4; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = events[i];
+            // Only the leader starts disabled; the others follow it.
+            attr.disabled = i == 0;
+            attr.inherit = inherit;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0);
+            if (fds_[i] < 0) {
+                close_all();
+                return false;
+            }
+        }
+        inherit_ = inherit;
+        return true;
+    }
+
+    void close_all() {
+        for (int& fd : fds_) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+
+    int fds_[4] = { -1, -1, -1, -1 };
+    bool inherit_ = false;
+};
+
+// Scenarios add their results here so the compiler cannot discard the
+// work being timed.
+inline volatile uint64_t bench_sink = 0;
+
+inline bool bench_selected(const bench_config& config, const std::string& name) {
+    return config.filter.empty() || name.find(config.filter) != std::string::npos;
+}
+
+// Value at percentile `p` (0-100) of `sorted`, interpolating linearly
+// between the nearest ranks.
+inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    double rank = p / 100.0 * (sorted.size() - 1);
+    size_t lo = (size_t)rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - lo);
+}
+
+//***********************************************************************
+//
+// run_bench
+//
+// Run `fn` as described above and append its result to `results`.
+// Scenarios filtered out by the config are skipped. The counters are
+// read from `perf`, which the caller opens before starting any threads
+// the scenario reuses across repetitions; the overload without it opens
+// a fresh group.
+//
+//***********************************************************************
+template <typename Fn>
+void run_bench(std::vector<bench_result>& results, const bench_config& config, perf_group& perf,
+               const std::string& name, const std::string& unit, uint64_t items, Fn&& fn) {
+    if (!bench_selected(config, name)) return;
+
+    for (int i = 0; i < config.warmup; i++) fn();
+
+    bench_result result;
+    result.name = name;
+    result.unit = unit;
+    result.items = items;
+    for (int i = 0; i < config.reps; i++) {
+        perf.start();
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        perf.stop();
+        result.ns.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+    }
+    perf.collect(result.counters);
+
+    std::vector<double> sorted = result.ns;
+    std::sort(sorted.begin(), sorted.end());
+    fprintf(stderr, "%-36s %12.3f ms (p50)\n", name.c_str(), percentile(sorted, 50) / 1e6);
+    results.push_back(std::move(result));
+}
+
+template <typename Fn>
+void run_bench(std::vector<bench_result>& results, const bench_config& config,
+               const std::string& name, const std::string& unit, uint64_t items, Fn&& fn) {
+    if (!bench_selected(config, name)) return;
+    perf_group perf;
+    run_bench(results, config, perf, name, unit, items, std::forward<Fn>(fn));
+}
+
+// Write `text` to `out` as a quoted JSON string, escaping quotes,
+// backslashes and control characters.
+inline void write_json_string(FILE* out, const std::string& text) {
+    fputc('"', out);
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+//***********************************************************************
+//
+// write_json
+//
+// Write all results to `out`: per scenario the timing distribution in
+// nanoseconds, throughput in items per second at the median, and the
+// counters (or null when unavailable). The counters' "threads" field is
+// "inherited" when threads the scenario started were counted and
+// "calling" when only the calling thread was.
+//
+//***********************************************************************
+inline void write_json(FILE* out, const std::vector<bench_result>& results, const bench_config& config) {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    fprintf(out, "{\n  \"timestamp\": %lld,\n  \"host\": ",
+            (long long)std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+    write_json_string(out, host);
+    fprintf(out, ",\n");
+    fprintf(out, "  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [", config.warmup, config.reps);
+    for (size_t r = 0; r < results.size(); r++) {
+        const bench_result& res = results[r];
+        std::vector<double> sorted = res.ns;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0, var = 0;
+        for (double v : sorted) mean += v;
+        mean /= sorted.size();
+        for (double v : sorted) var += (v - mean) * (v - mean);
+        double stddev = sorted.size() > 1 ? std::sqrt(var / (sorted.size() - 1)) : 0;
+        double p50 = percentile(sorted, 50);
+
+        fprintf(out, "%s\n    {\n", r ? "," : "");
+        fprintf(out, "      \"name\": ");
+        write_json_string(out, res.name);
+        fprintf(out, ",\n      \"unit\": ");
+        write_json_string(out, res.unit);
+        fprintf(out, ",\n      \"items\": %llu,\n", (unsigned long long)res.items);
+        fprintf(out, "      \"ns\": { \"min\": %.0f, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, "
+                     "\"max\": %.0f, \"mean\": %.0f, \"stddev\": %.0f },\n",
+                sorted.front(), p50, percentile(sorted, 90), percentile(sorted, 99),
+                sorted.back(), mean, stddev);
+        fprintf(out, "      \"items_per_sec\": %.1f,\n", p50 > 0 ? res.items / (p50 / 1e9) : 0.0);
+        if (res.counters.available) {
+            fprintf(out, "      \"counters\": { \"threads\": \"%s\", \"cycles\": %llu, \"instructions\": %llu, "
+                         "\"cache_misses\": %llu, \"branch_misses\": %llu }\n",
+                    res.counters.inherited ? "inherited" : "calling",
+                    (unsigned long long)res.counters.cycles, (unsigned long long)res.counters.instructions,
+                    (unsigned long long)res.counters.cache_misses, (unsigned long long)res.counters.branch_misses);
+        } else {
+            fprintf(out, "      \"counters\": null\n");
+        }
+        fprintf(out, "    }");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+#endif
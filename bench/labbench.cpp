@@ -0,0 +1,309 @@
+#include <pthread.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "bench.h"
+#include "../common/executor.h"
+#include "../project2/fibcore.h"
+#include "../project3/wordscan.h"
+#include "../project4/buffer.h"
+#include "../project7/schedulers.h"
+#include "../project7/elevator.h"
+
+// Disk size used for every disk scheduling scenario
+#define DISK_SIZE 3000
+
+//***********************************************************************
+//
+// Buffer handoff scenario
+//
+// Producers and consumers move items through the project4 bounded
+// buffer using exactly the producerconsumer synchronization (empty/full
+// semaphores around the mutex-protected buffer_insert_item and
+// buffer_remove_item), minus the random sleeps, so the rate measured is
+// the raw handoff cost.
+//
+//***********************************************************************
+struct handoff_args {
+    long items;
+};
+
+void* handoff_producer(void* arg) {
+    long items = static_cast<handoff_args*>(arg)->items;
+    for (long i = 0; i < items; i++) {
+        sem_wait(&empty);
+        pthread_mutex_lock(&mutex);
+        buffer_insert_item(i % 100 + 1);
+        pthread_mutex_unlock(&mutex);
+        sem_post(&full);
+    }
+    return nullptr;
+}
+
+void* handoff_consumer(void* arg) {
+    long items = static_cast<handoff_args*>(arg)->items;
+    for (long i = 0; i < items; i++) {
+        sem_wait(&full);
+        pthread_mutex_lock(&mutex);
+        buffer_remove_item();
+        pthread_mutex_unlock(&mutex);
+        sem_post(&empty);
+    }
+    return nullptr;
+}
+
+void buffer_handoff(int producers, int consumers, long items) {
+    buffer_init();
+    producer_index = consumer_index = 0;
+    handoff_args produce = { items / producers };
+    handoff_args consume = { items / consumers };
+    std::vector<pthread_t> threads(producers + consumers);
+    for (int i = 0; i < producers; i++)
+        pthread_create(&threads[i], nullptr, handoff_producer, &produce);
+    for (int i = 0; i < consumers; i++)
+        pthread_create(&threads[producers + i], nullptr, handoff_consumer, &consume);
+    for (auto& thread : threads)
+        pthread_join(thread, nullptr);
+    pthread_mutex_destroy(&mutex);
+    sem_destroy(&empty);
+    sem_destroy(&full);
+}
+
+// Random cylinder requests in [0, DISK_SIZE), fixed seed for repeatability.
+std::vector<int> make_requests(size_t n) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dist(0, DISK_SIZE - 1);
+    std::vector<int> cylinders(n);
+    for (int& c : cylinders) c = dist(gen);
+    return cylinders;
+}
+
+// Random text of words from a small vocabulary separated by mixed
+// whitespace, about `bytes` long.
+std::string make_text(size_t bytes, bool utf8) {
+    static const char* ascii_words[] = { "apple", "Banana", "egg", "zed", "Ice", "up", "the", "of", "orange", "quick" };
+    static const char* utf8_words[] = { "über", "Ärger", "straße", "öl", "haus", "Eis", "apfel", "zug", "ähnlich", "und" };
+    static const char* spaces[] = { " ", " ", " ", "\n", "\t", "  " };
+    const char** words = utf8 ? utf8_words : ascii_words;
+    std::mt19937 gen(7);
+    std::string text;
+    text.reserve(bytes + 16);
+    while (text.size() < bytes) {
+        text += words[gen() % 10];
+        text += spaces[gen() % 6];
+    }
+    return text;
+}
+
+//***********************************************************************
+//
+// Nested parallel_for scenario
+//
+// Sums a rows x cols matrix with one parallel_for over the rows whose
+// slices each run a parallel_for over their row's columns, so the
+// inner calls wait inside pool tasks and have to help run the queue
+// rather than block a worker.
+//
+//***********************************************************************
+uint64_t nested_sum(executor& pool, const std::vector<uint32_t>& matrix, size_t rows, size_t cols) {
+    std::vector<uint64_t> row_sums(rows);
+    pool.parallel_for(0, rows, 1, [&](size_t row_lo, size_t row_hi) {
+        for (size_t r = row_lo; r < row_hi; r++) {
+            std::atomic<uint64_t> sum(0);
+            pool.parallel_for(0, cols, 1024, [&](size_t lo, size_t hi) {
+                uint64_t s = 0;
+                for (size_t c = lo; c < hi; c++) s += matrix[r * cols + c];
+                sum.fetch_add(s, std::memory_order_relaxed);
+            });
+            row_sums[r] = sum.load(std::memory_order_relaxed);
+        }
+    });
+    uint64_t total = 0;
+    for (uint64_t s : row_sums) total += s;
+    return total;
+}
+
+// Returns true if an exception thrown in one inner slice of a nested
+// parallel_for reaches the outer caller.
+bool nested_exception_propagates(executor& pool) {
+    try {
+        pool.parallel_for(0, 16, 1, [&](size_t row, size_t) {
+            pool.parallel_for(0, 4096, 256, [&](size_t lo, size_t) {
+                if (row == 5 && lo == 2048) throw std::runtime_error("slice failed");
+            });
+        });
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--reps N] [--warmup N] [--filter SUBSTRING] [--out FILE]\n", prog);
+}
+
+//***********************************************************************
+//
+// main
+//
+// Runs every scenario selected by --filter and writes the results as
+// JSON to --out (stdout by default). Progress goes to stderr.
+//
+//***********************************************************************
+int main(int argc, char* argv[]) {
+    bench_config config;
+    const char* out_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "--reps") config.reps = atoi(argv[++i]);
+        else if (arg == "--warmup") config.warmup = atoi(argv[++i]);
+        else if (arg == "--filter") config.filter = argv[++i];
+        else if (arg == "--out") out_path = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.reps < 1) config.reps = 1;
+
+    std::vector<bench_result> results;
+
+    // project4: bounded buffer handoff rate
+    const long handoff_items = 200000;
+    run_bench(results, config, "buffer_handoff/1p1c", "items", handoff_items,
+              [&] { buffer_handoff(1, 1, handoff_items); });
+    run_bench(results, config, "buffer_handoff/4p4c", "items", handoff_items,
+              [&] { buffer_handoff(4, 4, handoff_items); });
+
+    // project7: SSTF is quadratic, the elevator family n log n
+    for (size_t n : { 1000, 4000, 16000 }) {
+        std::vector<int> cylinders = make_requests(n);
+        run_bench(results, config, "disk/sstf/n=" + std::to_string(n), "requests", n,
+                  [&] { bench_sink += sstf(cylinders, DISK_SIZE / 2, DISK_SIZE); });
+    }
+    for (size_t n : { 1000, 10000, 100000, 1000000 }) {
+        std::string suffix = "/n=" + std::to_string(n);
+        std::vector<int> cylinders = make_requests(n);
+        run_bench(results, config, "disk/scan" + suffix, "requests", n,
+                  [&] { bench_sink += scan(cylinders, DISK_SIZE / 2, DISK_SIZE); });
+        run_bench(results, config, "disk/cscan" + suffix, "requests", n,
+                  [&] { bench_sink += cscan(cylinders, DISK_SIZE / 2, DISK_SIZE); });
+        run_bench(results, config, "disk/look" + suffix, "requests", n,
+                  [&] { bench_sink += look(cylinders, DISK_SIZE / 2); });
+        run_bench(results, config, "disk/clook" + suffix, "requests", n,
+                  [&] { bench_sink += clook(cylinders, DISK_SIZE / 2); });
+    }
+
+    // project7: elevator totals for every head position, re-sorting per
+    // head versus one request_set
+    {
+        std::vector<int> cylinders = make_requests(DISK_SIZE);
+        run_bench(results, config, "disk/sweep/batch/n=3000", "heads", DISK_SIZE, [&] {
+            for (int head = 0; head < DISK_SIZE; head++)
+                bench_sink += scan(cylinders, head, DISK_SIZE) + cscan(cylinders, head, DISK_SIZE) +
+                              look(cylinders, head) + clook(cylinders, head);
+        });
+        run_bench(results, config, "disk/sweep/request_set/n=3000", "heads", DISK_SIZE, [&] {
+            request_set requests(cylinders, DISK_SIZE);
+            for (int head = 0; head < DISK_SIZE; head++)
+                bench_sink += requests.scan(head) + requests.cscan(head) +
+                              requests.look(head) + requests.clook(head);
+        });
+    }
+
+    // project7: streaming elevator, one insert and one completion per
+    // op at a steady queue depth
+    for (int depth : { 16, 1024 }) {
+        const uint64_t ops = 1000000;
+        std::vector<int> cylinders = make_requests(ops + depth);
+        for (bool circular : { false, true }) {
+            std::string name = std::string("disk/elevator/") + (circular ? "clook" : "look") +
+                               "/depth=" + std::to_string(depth);
+            run_bench(results, config, name, "ops", ops, [&] {
+                elevator engine(DISK_SIZE, DISK_SIZE / 2, circular);
+                for (int i = 0; i < depth; i++) engine.insert(cylinders[i], i);
+                completion done;
+                for (uint64_t i = 0; i < ops; i++) {
+                    engine.insert(cylinders[depth + i], depth + i);
+                    engine.next(done);
+                }
+                bench_sink += engine.total_movement();
+            });
+        }
+    }
+
+    // project3: tokenize + classify throughput
+    {
+        vowel_set english, german;
+        vowel_set_init(english, vowel_set_preset("en"));
+        vowel_set_init(german, vowel_set_preset("de"));
+        std::string ascii = make_text(16 << 20, false);
+        std::string utf8 = make_text(16 << 20, true);
+        word_scan scan;
+        std::string isa = scan_words_isa();
+        run_bench(results, config, "vowcons/scan_words/ascii/" + isa, "bytes", ascii.size(), [&] {
+            scan.clear();
+            scan_words(ascii.data(), ascii.data() + ascii.size(), english, scan);
+            bench_sink += scan.vowel_words.size();
+        });
+        run_bench(results, config, "vowcons/scan_words/utf8/" + isa, "bytes", utf8.size(), [&] {
+            scan.clear();
+            scan_words(utf8.data(), utf8.data() + utf8.size(), german, scan);
+            bench_sink += scan.vowel_words.size();
+        });
+    }
+
+    // project2: Fibonacci generation
+    for (uint64_t n : { 100000, 1000000 }) {
+        run_bench(results, config, "fib/big/n=" + std::to_string(n), "terms", 1, [&] {
+            bignum f;
+            bn_init(&f);
+            fib_big(&f, n);
+            bench_sink += f.len;
+            bn_free(&f);
+        });
+    }
+    {
+        const uint64_t terms = 1000000;
+        std::vector<char> buf(terms * FIB_MOD_LINE_MAX);
+        run_bench(results, config, "fib/mod_format/m=1e9+7", "terms", terms,
+                  [&] { bench_sink += fib_mod_format(buf.data(), 0, terms, 1000000007); });
+    }
+
+    // common: nested parallel_for on the work-stealing executor, checked
+    // for the right answer and for exception propagation before timing.
+    // The setup and checks are skipped with the scenario when --filter
+    // leaves it out.
+    if (bench_selected(config, "executor/parallel_for/nested")) {
+        const size_t rows = 256, cols = 16384;
+        std::vector<uint32_t> matrix(rows * cols);
+        std::mt19937 gen(11);
+        uint64_t expected = 0;
+        for (uint32_t& v : matrix) expected += v = gen() % 1000;
+        // The pool's workers outlive every repetition, so the counters
+        // are opened before the pool for the workers to inherit them.
+        perf_group perf;
+        executor pool;
+        if (nested_sum(pool, matrix, rows, cols) != expected || !nested_exception_propagates(pool)) {
+            fprintf(stderr, "executor/parallel_for: nested check failed\n");
+            return 1;
+        }
+        run_bench(results, config, perf, "executor/parallel_for/nested", "elements", rows * cols,
+                  [&] { bench_sink += nested_sum(pool, matrix, rows, cols); });
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (out == nullptr) {
+        perror(out_path);
+        return 1;
+    }
+    write_json(out, results, config);
+    if (out_path) fclose(out);
+    return 0;
+}
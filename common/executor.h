@@ -0,0 +1,270 @@
+#ifndef _EXECUTOR_H_DEFINED_
+#define _EXECUTOR_H_DEFINED_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//***********************************************************************
+//
+// executor
+//
+// A fixed pool of worker threads, each with its own task deque. A worker
+// pushes and pops tasks it submits itself at the back of its own deque
+// (LIFO, cache friendly); tasks submitted from outside the pool are
+// spread round-robin. An idle worker steals from the front of the other
+// deques before going to sleep, so work submitted to a busy worker is
+// picked up by whoever is free.
+//
+//   executor pool(4);
+//   std::future<int> f = pool.submit([] { return 42; });
+//   pool.parallel_for(0, n, 1024, [&](size_t lo, size_t hi) { ... });
+//   pool.shutdown();   // Runs every queued task, then joins
+//
+// Tasks may block (e.g. on a semaphore), but each blocked task holds a
+// worker, so the pool needs at least as many workers as tasks that
+// block on one another.
+//
+//***********************************************************************
+class executor {
+public:
+    explicit executor(unsigned num_threads = std::thread::hardware_concurrency()) {
+        if (num_threads == 0) num_threads = 1;
+        for (unsigned i = 0; i < num_threads; i++)
+            queues_.push_back(std::make_unique<worker_queue>());
+        for (unsigned i = 0; i < num_threads; i++)
+            threads_.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    ~executor() { shutdown(); }
+
+    size_t size() const { return queues_.size(); }
+
+    // Queue `fn` and return a future for its result. Exceptions thrown
+    // by `fn` are delivered through the future.
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>>> {
+        using result_type = std::invoke_result_t<std::decay_t<Fn>>;
+        std::packaged_task<result_type()> job(std::forward<Fn>(fn));
+        std::future<result_type> result = job.get_future();
+        push(task(std::move(job)));
+        return result;
+    }
+
+    // Queue `fn` with no future, for callers that track completion
+    // themselves.
+    template <typename Fn>
+    void post(Fn&& fn) {
+        push(task(std::forward<Fn>(fn)));
+    }
+
+    //*******************************************************************
+    //
+    // parallel_for
+    //
+    // Call fn(lo, hi) over [begin, end) in slices of at most `grain`
+    // elements and return once every slice has run. The calling thread
+    // runs queued tasks while it waits, so this is safe to call from
+    // inside a task, including another parallel_for's slice.
+    //
+    // If a slice throws, slices that have not started yet are skipped,
+    // and the first exception is rethrown here once the others are done.
+    //
+    // When there is nothing left to run but slices are still running on
+    // other threads, the caller sleeps until the last slice finishes or
+    // new work is queued.
+    //
+    //*******************************************************************
+    template <typename Fn>
+    void parallel_for(size_t begin, size_t end, size_t grain, Fn&& fn) {
+        if (begin >= end) return;
+        if (grain == 0) grain = 1;
+        size_t slices = (end - begin + grain - 1) / grain;
+        std::atomic<size_t> remaining(slices);
+        std::atomic<bool> failed(false);
+        std::exception_ptr error;
+        for (size_t s = 0; s < slices; s++) {
+            size_t lo = begin + s * grain;
+            size_t hi = std::min(lo + grain, end);
+            post([this, &fn, &remaining, &failed, &error, lo, hi] {
+                if (!failed.load(std::memory_order_relaxed)) {
+                    try {
+                        fn(lo, hi);
+                    } catch (...) {
+                        // Only the first thrower writes `error`; the
+                        // decrement below publishes it to the caller.
+                        if (!failed.exchange(true, std::memory_order_relaxed))
+                            error = std::current_exception();
+                    }
+                }
+                // The caller may return as soon as this reaches zero, so
+                // nothing captured by reference is touched after it.
+                if (remaining.fetch_sub(1) == 1) wake_sleepers(true);
+            });
+        }
+        while (remaining.load() != 0) {
+            if (try_run_one(current_index())) continue;
+            sleep_until([&remaining] { return remaining.load() == 0; });
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Run everything already queued and join the workers. Nothing may be
+    // submitted from outside the pool afterwards. Safe to call more than
+    // once.
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock_);
+            if (stopping_ && threads_.empty()) return;
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) thread.join();
+        threads_.clear();
+    }
+
+private:
+    // Move-only type-erased callable, so packaged_task can be queued.
+    class task {
+    public:
+        task() = default;
+
+        template <typename Fn>
+        explicit task(Fn&& fn) : impl_(new model<std::decay_t<Fn>>(std::forward<Fn>(fn))) {}
+
+        void operator()() { impl_->run(); }
+
+    private:
+        struct concept_t {
+            virtual ~concept_t() = default;
+            virtual void run() = 0;
+        };
+        template <typename Fn>
+        struct model : concept_t {
+            explicit model(Fn&& f) : fn(std::move(f)) {}
+            explicit model(const Fn& f) : fn(f) {}
+            void run() override { fn(); }
+            Fn fn;
+        };
+        std::unique_ptr<concept_t> impl_;
+    };
+
+    struct worker_queue {
+        std::mutex lock;
+        std::deque<task> tasks;
+    };
+
+    // Index of the calling worker in this pool, or size() if the caller
+    // is not one of its workers.
+    size_t current_index() const {
+        return current_pool_ == this ? current_worker_ : queues_.size();
+    }
+
+    void push(task t) {
+        size_t index = current_index();
+        if (index == queues_.size())
+            index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        // Count the task before it becomes visible, so a thief that runs
+        // it at once cannot take `pending_` below zero. A worker that
+        // sees the count first just retries until the push lands.
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> guard(queues_[index]->lock);
+            queues_[index]->tasks.push_back(std::move(t));
+        }
+        wake_sleepers(false);
+    }
+
+    // Wake one sleeper for a new task, or all of them when a parallel_for
+    // has finished, since only its caller is waiting for that. The sleep
+    // lock is only taken when someone is asleep: a sleeper counts itself
+    // in `sleepers_` before its last check, and the caller changed
+    // `pending_` or a slice count before reading `sleepers_`, so with
+    // seq_cst ordering one of the two sees the other.
+    void wake_sleepers(bool all) {
+        if (sleepers_.load() == 0) return;
+        { std::lock_guard<std::mutex> guard(sleep_lock_); }
+        if (all)
+            wake_.notify_all();
+        else
+            wake_.notify_one();
+    }
+
+    // Sleep until a task is queued, the pool is stopping or `done()`
+    // holds, and return whether it is stopping. Every sleeper wakes for
+    // a new task, so whichever one a notify_one reaches can run it.
+    template <typename Pred>
+    bool sleep_until(Pred done) {
+        std::unique_lock<std::mutex> guard(sleep_lock_);
+        sleepers_.fetch_add(1);
+        wake_.wait(guard, [this, &done] {
+            return pending_.load() > 0 || stopping_ || done();
+        });
+        sleepers_.fetch_sub(1);
+        return stopping_;
+    }
+
+    // Run one task: the back of our own deque first, then the front of
+    // each other deque in turn. Returns false if every deque was empty.
+    bool try_run_one(size_t self) {
+        task t;
+        bool found = false;
+        size_t n = queues_.size();
+        if (self < n) {
+            std::lock_guard<std::mutex> guard(queues_[self]->lock);
+            if (!queues_[self]->tasks.empty()) {
+                t = std::move(queues_[self]->tasks.back());
+                queues_[self]->tasks.pop_back();
+                found = true;
+            }
+        }
+        for (size_t k = 1; !found && k <= n; k++) {
+            size_t victim = (self + k) % n;
+            std::lock_guard<std::mutex> guard(queues_[victim]->lock);
+            if (!queues_[victim]->tasks.empty()) {
+                t = std::move(queues_[victim]->tasks.front());
+                queues_[victim]->tasks.pop_front();
+                found = true;
+            }
+        }
+        if (!found) return false;
+        pending_.fetch_sub(1);
+        t();
+        return true;
+    }
+
+    void worker_loop(size_t index) {
+        current_pool_ = this;
+        current_worker_ = index;
+        while (true) {
+            if (try_run_one(index)) continue;
+            if (sleep_until([] { return false; }) && pending_.load() == 0) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<size_t> pending_{0};     // Tasks queued but not yet started
+    std::atomic<size_t> sleepers_{0};    // Threads waiting on wake_
+    std::mutex sleep_lock_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    inline static thread_local const executor* current_pool_ = nullptr;
+    inline static thread_local size_t current_worker_ = 0;
+};
+
+#endif
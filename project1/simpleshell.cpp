@@ -2,9 +2,11 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <unordered_map>
 #include <stdlib.h>
 #include <wait.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <csignal>
 
 using namespace std;
@@ -17,6 +19,90 @@ void sigint_handler(int sig)   { sigint_count++; }
 void sigquit_handler(int sig)  { sigquit_count++; }
 void sigtstp_handler(int sig)  { sigtstp_count++; }
 
+// Hashed command cache: maps a command name to the absolute path it
+// resolved to, so repeated commands skip the $PATH walk in execvp.
+struct hash_entry {
+    string path;                    // Resolved absolute path
+    vector<struct timespec> mtimes; // mtime of each PATH dir searched, in order
+    int hits;                       // Times this entry was used
+};
+unordered_map<string, hash_entry> command_hash;
+string hashed_path_var; // Value of $PATH the cache was filled under
+
+// Split $PATH into its directories; an empty entry means the cwd
+vector<string> path_dirs(const string &path_var){
+    vector<string> dirs;
+    stringstream paths(path_var);
+    string dir;
+    while (getline(paths, dir, ':')) {
+        dirs.push_back(dir.empty() ? "." : dir);
+    }
+    return dirs;
+}
+
+// Return a directory's mtime, or a zero timespec if it cannot be stat'd
+struct timespec dir_mtime(const string &dir){
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) return {0, 0};
+    return st.st_mtim;
+}
+
+//***********************************************************************
+//
+// resolve_command
+//
+// Look up `name` in the command hash, falling back to a $PATH search on
+// a miss. An entry is dropped when $PATH has changed since the cache was
+// filled, or when any directory searched up to and including the one
+// the command was found in has a new mtime (a command could have been
+// added earlier in $PATH, or the hashed one removed). Names containing a
+// '/' are not hashed. Returns an empty string if nothing was found.
+//
+//***********************************************************************
+string resolve_command(const string &name){
+    if (name.find('/') != string::npos) return name;
+
+    const char *env = getenv("PATH");
+    string path_var = env ? env : "";
+    if (path_var != hashed_path_var) {
+        command_hash.clear();
+        hashed_path_var = path_var;
+    }
+    vector<string> dirs = path_dirs(path_var);
+
+    auto it = command_hash.find(name);
+    if (it != command_hash.end()) {
+        bool stale = false;
+        for (size_t i = 0; i < it->second.mtimes.size() && !stale; i++) {
+            struct timespec now = dir_mtime(dirs[i]);
+            stale = now.tv_sec != it->second.mtimes[i].tv_sec ||
+                    now.tv_nsec != it->second.mtimes[i].tv_nsec;
+        }
+        if (!stale) {
+            it->second.hits++;
+            return it->second.path;
+        }
+        command_hash.erase(it);
+    }
+
+    // Record each directory's mtime before probing it, so a change made
+    // during the search invalidates the entry on the next lookup.
+    hash_entry entry;
+    entry.hits = 1;
+    for (auto &dir : dirs) {
+        entry.mtimes.push_back(dir_mtime(dir));
+        string candidate = dir + "/" + name;
+        struct stat st;
+        if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+            access(candidate.c_str(), X_OK) == 0) {
+            entry.path = candidate;
+            command_hash[name] = entry;
+            return candidate;
+        }
+    }
+    return "";
+}
+
 // Parse user input into individual command arguments
 void parse_args(string line, vector<string> &cmds){
     stringstream liness(line);
@@ -54,7 +140,7 @@ int main(void)
         if (cmd == "help") {
             cout << "//*********************************************************\n";
             cout << "// OS Project #1: My Shell - Writing Your Own Shell\n";
-            cout << "// This shell supports the following commands: help, exit, history\n";
+            cout << "// This shell supports the following commands: help, exit, history, hash\n";
             cout << "//*********************************************************\n";
             continue;
         } else if(cmd == "exit") {
@@ -75,12 +161,39 @@ int main(void)
                 cout << *it << " ";
             cout << endl;
             continue;
+        } else if (cmd == "hash") {
+            if (command_hash.empty()) {
+                cout << "hash: hash table empty" << endl;
+                continue;
+            }
+            cout << "hits    command" << endl;
+            for (auto &entry : command_hash) {
+                string hits = to_string(entry.second.hits);
+                cout << string(hits.size() < 4 ? 4 - hits.size() : 0, ' ') << hits
+                     << "    " << entry.second.path << endl;
+            }
+            continue;
+        } else if (cmd == "hash -r") {
+            command_hash.clear();
+            continue;
         }
 
         // Parse command and arguments
         vector<string> cmd_args;
         parse_args(cmd, cmd_args);
 
+        // Resolve the command in the parent so the cache persists
+        // between commands; the child then execs the path directly. A
+        // miss has already searched every $PATH directory, so report it
+        // here rather than forking for execvp to search them again.
+        // Only with $PATH unset is execvp left to search, since it then
+        // uses its own default path.
+        string cmd_path = resolve_command(cmd_args[0]);
+        if (cmd_path.empty() && getenv("PATH") != NULL) {
+            cout << "Error: command not found" << endl;
+            continue;
+        }
+
         // Fork a child process to execute the command
         int pid = fork();
         int status;
@@ -101,7 +214,10 @@ int main(void)
             for (auto &arg : cmd_args) argv.push_back(const_cast<char*>(arg.c_str()));
             argv.push_back(NULL);
 
-            execvp(argv[0], argv.data()); // Execute command
+            if (!cmd_path.empty())
+                execv(cmd_path.c_str(), argv.data()); // Execute resolved command
+            else
+                execvp(argv[0], argv.data()); // $PATH unset; execvp uses its default path
             cout << "Error: command not found" << endl; // execvp failed
             exit(1);
         } else {
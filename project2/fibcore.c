@@ -0,0 +1,902 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "fibcore.h"
+
+//***********************************************************************
+//
+// Limb-array helpers
+//
+// These operate on raw base 10^9 limb arrays. Lengths are always passed
+// explicitly; callers are responsible for sizing destinations so that
+// results fit.
+//
+//***********************************************************************
+
+// Drop leading zero limbs and return the resulting length.
+static size_t limbs_trim(const uint32_t *a, size_t n)
+{
+  while (n > 0 && a[n - 1] == 0)
+    n--;
+  return n;
+}
+
+// r[0..rn) += a[0..an). Requires rn >= an and that the sum fits in rn
+// limbs.
+static void limbs_add_to(uint32_t *r, size_t rn, const uint32_t *a, size_t an)
+{
+  uint32_t carry = 0;
+  size_t i;
+  for (i = 0; i < an; i++) {
+    uint32_t t = r[i] + a[i] + carry;
+    carry = t >= BN_BASE;
+    r[i] = carry ? t - BN_BASE : t;
+  }
+  for (; carry && i < rn; i++) {
+    uint32_t t = r[i] + 1;
+    carry = t == BN_BASE;
+    r[i] = carry ? 0 : t;
+  }
+}
+
+// r[0..rn) -= a[0..an). Requires the value in r to be >= a.
+static void limbs_sub_from(uint32_t *r, size_t rn, const uint32_t *a, size_t an)
+{
+  uint32_t borrow = 0;
+  size_t i;
+  for (i = 0; i < an; i++) {
+    uint32_t s = a[i] + borrow;
+    borrow = r[i] < s;
+    r[i] = borrow ? r[i] + BN_BASE - s : r[i] - s;
+  }
+  for (; borrow && i < rn; i++) {
+    borrow = r[i] == 0;
+    r[i] = borrow ? BN_BASE - 1 : r[i] - 1;
+  }
+}
+
+// r[0..an+bn) = a * b using the schoolbook method.
+static void limbs_mul_basecase(uint32_t *r, const uint32_t *a, size_t an,
+                               const uint32_t *b, size_t bn)
+{
+  memset(r, 0, (an + bn) * sizeof(uint32_t));
+  for (size_t i = 0; i < an; i++) {
+    uint64_t carry = 0;
+    uint64_t ai = a[i];
+    if (ai == 0)
+      continue;
+    for (size_t j = 0; j < bn; j++) {
+      uint64_t t = r[i + j] + ai * b[j] + carry;
+      r[i + j] = (uint32_t)(t % BN_BASE);
+      carry = t / BN_BASE;
+    }
+    r[i + bn] = (uint32_t)carry;
+  }
+}
+
+//***********************************************************************
+//
+// limbs_mul
+//
+// r[0..an+bn) = a * b. Uses Karatsuba once both operands are at least
+// KARATSUBA_CUTOFF limbs: with a = a1*B^m + a0 and b = b1*B^m + b0,
+//
+//   a*b = z2*B^2m + (((a0+a1)(b0+b1)) - z0 - z2)*B^m + z0
+//
+// where z0 = a0*b0 and z2 = a1*b1, so three half-size products replace
+// four. Operands of very different length are multiplied in slices of
+// the shorter one so each recursive call stays balanced.
+//
+//***********************************************************************
+static void limbs_mul(uint32_t *r, const uint32_t *a, size_t an,
+                      const uint32_t *b, size_t bn)
+{
+  if (an < bn) {
+    const uint32_t *tp = a; a = b; b = tp;
+    size_t tn = an; an = bn; bn = tn;
+  }
+  if (bn < KARATSUBA_CUTOFF) {
+    limbs_mul_basecase(r, a, an, b, bn);
+    return;
+  }
+
+  size_t m = (an + 1) / 2;
+  if (bn <= m) {
+    // Unbalanced: multiply b by successive bn-limb slices of a.
+    uint32_t *t = malloc(2 * bn * sizeof(uint32_t));
+    memset(r, 0, (an + bn) * sizeof(uint32_t));
+    for (size_t off = 0; off < an; off += bn) {
+      size_t piece = an - off < bn ? an - off : bn;
+      limbs_mul(t, a + off, piece, b, bn);
+      limbs_add_to(r + off, an + bn - off, t, limbs_trim(t, piece + bn));
+    }
+    free(t);
+    return;
+  }
+
+  const uint32_t *a0 = a, *a1 = a + m, *b0 = b, *b1 = b + m;
+  size_t a0n = limbs_trim(a0, m), b0n = limbs_trim(b0, m);
+  size_t a1n = an - m, b1n = bn - m;
+
+  // z0 and z2 land in disjoint halves of r; the middle term is added on
+  // top afterwards.
+  memset(r, 0, (an + bn) * sizeof(uint32_t));
+  if (a0n && b0n)
+    limbs_mul(r, a0, a0n, b0, b0n);
+  limbs_mul(r + 2 * m, a1, a1n, b1, b1n);
+
+  uint32_t *sa = calloc(m + 1, sizeof(uint32_t));
+  uint32_t *sb = calloc(m + 1, sizeof(uint32_t));
+  uint32_t *z1 = malloc(2 * (m + 1) * sizeof(uint32_t));
+  memcpy(sa, a0, m * sizeof(uint32_t));
+  memcpy(sb, b0, m * sizeof(uint32_t));
+  limbs_add_to(sa, m + 1, a1, a1n);
+  limbs_add_to(sb, m + 1, b1, b1n);
+  size_t san = limbs_trim(sa, m + 1), sbn = limbs_trim(sb, m + 1);
+  size_t z1n = san + sbn;
+  limbs_mul(z1, sa, san, sb, sbn);
+  limbs_sub_from(z1, z1n, r, limbs_trim(r, 2 * m));
+  limbs_sub_from(z1, z1n, r + 2 * m, limbs_trim(r + 2 * m, a1n + b1n));
+  limbs_add_to(r + m, an + bn - m, z1, limbs_trim(z1, z1n));
+  free(sa);
+  free(sb);
+  free(z1);
+}
+
+//***********************************************************************
+//
+// bignum API
+//
+//***********************************************************************
+
+static void bn_reserve(bignum *a, size_t n)
+{
+  if (a->cap >= n)
+    return;
+  size_t cap = a->cap ? a->cap : 4;
+  while (cap < n)
+    cap *= 2;
+  a->limb = realloc(a->limb, cap * sizeof(uint32_t));
+  a->cap = cap;
+}
+
+void bn_init(bignum *a)
+{
+  a->limb = NULL;
+  a->len = 0;
+  a->cap = 0;
+}
+
+void bn_free(bignum *a)
+{
+  free(a->limb);
+  bn_init(a);
+}
+
+void bn_set_u32(bignum *a, uint32_t v)
+{
+  bn_reserve(a, 2);
+  a->limb[0] = v % BN_BASE;
+  a->limb[1] = v / BN_BASE;
+  a->len = limbs_trim(a->limb, 2);
+}
+
+void bn_copy(bignum *dst, const bignum *src)
+{
+  if (dst == src)
+    return;
+  bn_reserve(dst, src->len);
+  memcpy(dst->limb, src->limb, src->len * sizeof(uint32_t));
+  dst->len = src->len;
+}
+
+void bn_swap(bignum *a, bignum *b)
+{
+  bignum t = *a;
+  *a = *b;
+  *b = t;
+}
+
+// r = a + b. r may alias a or b.
+void bn_add(bignum *r, const bignum *a, const bignum *b)
+{
+  if (a->len < b->len) {
+    const bignum *t = a; a = b; b = t;
+  }
+  if (r == b && r != a) {
+    bignum t;
+    bn_init(&t);
+    bn_add(&t, a, b);
+    bn_swap(r, &t);
+    bn_free(&t);
+    return;
+  }
+  size_t alen = a->len, blen = b->len;
+  bn_reserve(r, alen + 1);
+  if (r != a)
+    memcpy(r->limb, a->limb, alen * sizeof(uint32_t));
+  r->limb[alen] = 0;
+  limbs_add_to(r->limb, alen + 1, b->limb, blen);
+  r->len = limbs_trim(r->limb, alen + 1);
+}
+
+// r = a - b. Requires a >= b; r may alias a or b.
+void bn_sub(bignum *r, const bignum *a, const bignum *b)
+{
+  if (r == b) {
+    bignum t;
+    bn_init(&t);
+    bn_sub(&t, a, b);
+    bn_swap(r, &t);
+    bn_free(&t);
+    return;
+  }
+  size_t alen = a->len;
+  bn_reserve(r, alen);
+  if (r != a)
+    memcpy(r->limb, a->limb, alen * sizeof(uint32_t));
+  limbs_sub_from(r->limb, alen, b->limb, b->len);
+  r->len = limbs_trim(r->limb, alen);
+}
+
+// r = a * b. r may alias a or b.
+void bn_mul(bignum *r, const bignum *a, const bignum *b)
+{
+  if (a->len == 0 || b->len == 0) {
+    r->len = 0;
+    return;
+  }
+  bignum t;
+  bn_init(&t);
+  bn_reserve(&t, a->len + b->len);
+  limbs_mul(t.limb, a->limb, a->len, b->limb, b->len);
+  t.len = limbs_trim(t.limb, a->len + b->len);
+  bn_swap(r, &t);
+  bn_free(&t);
+}
+
+void bn_print(FILE *out, const bignum *a)
+{
+  if (a->len == 0) {
+    fputs("0\n", out);
+    return;
+  }
+  fprintf(out, "%u", a->limb[a->len - 1]);
+  for (size_t i = a->len - 1; i-- > 0;)
+    fprintf(out, "%09u", a->limb[i]);
+  fputc('\n', out);
+}
+
+//***********************************************************************
+//
+// fib_big
+//
+// Compute F(n) with the fast-doubling identities
+//
+//   F(2k)   = F(k) * (2F(k+1) - F(k))
+//   F(2k+1) = F(k)^2 + F(k+1)^2
+//
+// walking the bits of n from the top, so only O(log n) big
+// multiplications are needed. The final step produces just the one
+// value asked for rather than the full pair.
+//
+//***********************************************************************
+void fib_big(bignum *f, uint64_t n)
+{
+  bignum a, b, t, u;
+  bn_init(&a); bn_init(&b); bn_init(&t); bn_init(&u);
+  bn_set_u32(&a, 0); // F(k)
+  bn_set_u32(&b, 1); // F(k+1)
+
+  uint64_t k = n >> 1;
+  int bit = 63;
+  while (bit >= 0 && !((k >> bit) & 1))
+    bit--;
+  for (; bit >= 0; bit--) {
+    bn_add(&t, &b, &b);
+    bn_sub(&t, &t, &a);
+    bn_mul(&t, &t, &a);  // F(2k)
+    bn_mul(&u, &a, &a);
+    bn_mul(&b, &b, &b);
+    bn_add(&u, &u, &b);  // F(2k+1)
+    if ((k >> bit) & 1) {
+      bn_add(&b, &t, &u); // F(2k+2)
+      bn_swap(&a, &u);
+    } else {
+      bn_swap(&a, &t);
+      bn_swap(&b, &u);
+    }
+  }
+
+  if (n & 1) {
+    bn_mul(&a, &a, &a);
+    bn_mul(&b, &b, &b);
+    bn_add(f, &a, &b);
+  } else {
+    bn_add(&t, &b, &b);
+    bn_sub(&t, &t, &a);
+    bn_mul(f, &t, &a);
+  }
+  bn_free(&a); bn_free(&b); bn_free(&t); bn_free(&u);
+}
+
+//***********************************************************************
+//
+// fib_stream
+//
+// Print F(0) .. F(n-1) to `out`, one per line. Only the two most recent
+// terms are kept, so memory is bounded by the size of the last term
+// rather than the length of the whole sequence.
+//
+//***********************************************************************
+void fib_stream(FILE *out, uint64_t n)
+{
+  bignum a, b;
+  bn_init(&a); bn_init(&b);
+  bn_set_u32(&a, 0);
+  bn_set_u32(&b, 1);
+  for (uint64_t i = 0; i < n; i++) {
+    bn_print(out, &a);
+    bn_add(&a, &a, &b);
+    bn_swap(&a, &b);
+  }
+  bn_free(&a); bn_free(&b);
+}
+
+//***********************************************************************
+//
+// Modular arithmetic helpers
+//
+// All values are kept in [0, m). Sums are formed without overflow so
+// any 64-bit modulus works.
+//
+//***********************************************************************
+static inline uint64_t addmod(uint64_t a, uint64_t b, uint64_t m)
+{
+  return a >= m - b ? a - (m - b) : a + b;
+}
+
+static inline uint64_t submod(uint64_t a, uint64_t b, uint64_t m)
+{
+  return a >= b ? a - b : a + (m - b);
+}
+
+// Moduli below 2^32 are reduced with Barrett's method: the quotient of
+// x / m is estimated as (x * mu) >> 64 with mu = floor((2^64-1) / m),
+// which is off by at most two, so the remainder needs at most two
+// corrections. Larger moduli fall back to a 128-bit division in mulmod.
+// Fast doubling, where nearly all the multiplies are, avoids that
+// division for odd moduli above 2^32 by working in Montgomery form (see
+// mont_mul); even ones and the recurrence matrices keep the division.
+typedef struct {
+  uint64_t m;
+  uint64_t mu;   // 0 when m does not fit in 32 bits
+  uint64_t minv; // m^-1 mod 2^64 for odd m above 2^32, else 0
+  uint64_t one;  // 2^64 mod m, which is 1 in Montgomery form, when minv is set
+} modulus;
+
+static inline void modulus_init(modulus *mod, uint64_t m)
+{
+  mod->m = m;
+  mod->mu = m <= UINT32_MAX ? UINT64_MAX / m : 0;
+  mod->minv = 0;
+  mod->one = 0;
+  if (!mod->mu && (m & 1)) {
+    // Newton's iteration doubles the correct low bits each step, and
+    // m is its own inverse mod 2^3.
+    uint64_t inv = m;
+    for (int i = 0; i < 5; i++)
+      inv *= 2 - m * inv;
+    mod->minv = inv;
+    mod->one = (uint64_t)(((unsigned __int128)1 << 64) % m);
+  }
+}
+
+static inline uint64_t mulmod(uint64_t a, uint64_t b, const modulus *mod)
+{
+  if (mod->mu) {
+    uint64_t x = a * b;
+    uint64_t q = (uint64_t)(((unsigned __int128)x * mod->mu) >> 64);
+    uint64_t r = x - q * mod->m;
+    if (r >= mod->m) r -= mod->m;
+    if (r >= mod->m) r -= mod->m;
+    return r;
+  }
+  return (uint64_t)((unsigned __int128)a * b % mod->m);
+}
+
+// a * b * 2^-64 mod m for a, b in [0, m), with minv set. u is chosen so
+// that a*b - u*m is a multiple of 2^64; its low words cancel, so the
+// result is the difference of the high words, in (-m, m).
+static inline uint64_t mont_mul(uint64_t a, uint64_t b, const modulus *mod)
+{
+  unsigned __int128 t = (unsigned __int128)a * b;
+  uint64_t u = (uint64_t)t * mod->minv;
+  uint64_t hi = (uint64_t)(t >> 64);
+  uint64_t um = (uint64_t)(((unsigned __int128)u * mod->m) >> 64);
+  return hi >= um ? hi - um : hi - um + mod->m;
+}
+
+//***********************************************************************
+//
+// fib_mod_pair
+//
+// Compute F(k) mod m and F(k+1) mod m with the same fast-doubling
+// identities used by fib_big. This lets any position in the sequence be
+// reached in O(log k) steps, which is how the parallel range mode seeds
+// each thread's chunk independently.
+//
+//***********************************************************************
+static void fib_mod_pair_r(uint64_t k, const modulus *mod, uint64_t *fk, uint64_t *fk1)
+{
+  uint64_t m = mod->m;
+  int bit = 63;
+  while (bit >= 0 && !((k >> bit) & 1))
+    bit--;
+  if (mod->minv) {
+    // Same steps in Montgomery form: sums are unchanged and mont_mul
+    // replaces mulmod. F(1) starts as `one`; multiplying by a plain 1
+    // converts back at the end.
+    uint64_t a = 0, b = mod->one;
+    for (; bit >= 0; bit--) {
+      uint64_t c = mont_mul(a, submod(addmod(b, b, m), a, m), mod);
+      uint64_t d = addmod(mont_mul(a, a, mod), mont_mul(b, b, mod), m);
+      if ((k >> bit) & 1) {
+        a = d;
+        b = addmod(c, d, m);
+      } else {
+        a = c;
+        b = d;
+      }
+    }
+    *fk = mont_mul(a, 1, mod);
+    *fk1 = mont_mul(b, 1, mod);
+    return;
+  }
+  uint64_t a = 0, b = 1 % m;
+  for (; bit >= 0; bit--) {
+    uint64_t c = mulmod(a, submod(addmod(b, b, m), a, m), mod); // F(2k)
+    uint64_t d = addmod(mulmod(a, a, mod), mulmod(b, b, mod), m);  // F(2k+1)
+    if ((k >> bit) & 1) {
+      a = d;
+      b = addmod(c, d, m);
+    } else {
+      a = c;
+      b = d;
+    }
+  }
+  *fk = a;
+  *fk1 = b;
+}
+
+void fib_mod_pair(uint64_t k, uint64_t m, uint64_t *fk, uint64_t *fk1)
+{
+  modulus mod;
+  modulus_init(&mod, m);
+  fib_mod_pair_r(k, &mod, fk, fk1);
+}
+
+//***********************************************************************
+//
+// fib_mod_format
+//
+// Write F(start) .. F(start+count-1) mod m into `buf` as decimal lines
+// and return the number of bytes written. `buf` must hold at least
+// count * FIB_MOD_LINE_MAX bytes.
+//
+//***********************************************************************
+size_t fib_mod_format(char *buf, uint64_t start, uint64_t count, uint64_t m)
+{
+  uint64_t a, b;
+  char digits[20];
+  char *p = buf;
+  fib_mod_pair(start, m, &a, &b);
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t v = a;
+    int nd = 0;
+    do {
+      digits[nd++] = (char)('0' + v % 10);
+      v /= 10;
+    } while (v);
+    while (nd)
+      *p++ = digits[--nd];
+    *p++ = '\n';
+    uint64_t c = addmod(a, b, m);
+    a = b;
+    b = c;
+  }
+  return (size_t)(p - buf);
+}
+
+//***********************************************************************
+//
+// Batch query caches
+//
+// Both caches are fixed-size open-addressing tables of entry pointers.
+// Lookups are lock-free loads; an entry is built outside any lock and
+// then published with a compare-and-swap, so the worst case under a race
+// is one redundant build. When the Pisano table fills up, queries simply
+// skip it.
+//
+// The recurrence table evicts with a clock over a short probe window: a
+// hit sets the entry's `referenced` bit, and a miss in a full window
+// takes the slot of the first entry whose bit was already clear,
+// clearing the bits it passes. An entry holds powers only up to the
+// highest bit of n any query has needed, and is replaced by a longer
+// one when a later query needs more. Other workers may still be reading
+// a replaced entry, so it is put on a retired list that
+// fib_query_cache_reclaim frees once the workers are idle. After
+// RECURRENCE_CACHE_SLOTS retirements without a reclaim, misses compute
+// their powers privately instead of replacing anything.
+//
+//***********************************************************************
+
+// F(i) mod m for one period of the Pisano cycle.
+typedef struct {
+  uint64_t m;
+  uint64_t period;
+  uint32_t *table;
+} pisano_entry;
+
+// Power-of-two powers of one recurrence's companion matrix mod m.
+typedef struct recurrence_entry {
+  uint64_t m;
+  int order;
+  int levels;                           // Number of powers built
+  _Atomic int referenced;               // Clock bit, set on every hit
+  uint64_t coeff[RECURRENCE_MAX_ORDER];
+  uint64_t *power;                      // C^(2^j) at power + j*order*order, row-major
+  struct recurrence_entry *retired_next;
+} recurrence_entry;
+
+// Slots probed per recurrence lookup, and so the reach of the clock.
+#define RECURRENCE_PROBES 8
+
+// Slots probed per Pisano lookup. Once a modulus's window is full it is
+// not tabulated, so a miss costs at most this many probes.
+#define PISANO_PROBES 8
+
+// Queries with n below this many times the order step the recurrence
+// directly: k multiplies per term beats k^2 per set bit of n and leaves
+// the cache to the queries that need it.
+#define RECURRENCE_STEP_FACTOR 8
+
+struct fib_query_cache {
+  _Atomic(pisano_entry *) pisano[PISANO_CACHE_SLOTS];
+  _Atomic(recurrence_entry *) recurrence[RECURRENCE_CACHE_SLOTS];
+  _Atomic(recurrence_entry *) retired;  // Replaced entries awaiting reclaim
+  _Atomic int num_retired;
+};
+
+static void recurrence_free(recurrence_entry *e)
+{
+  free(e->power);
+  free(e);
+}
+
+fib_query_cache *fib_query_cache_create(void)
+{
+  fib_query_cache *cache = malloc(sizeof(fib_query_cache));
+  for (int i = 0; i < PISANO_CACHE_SLOTS; i++)
+    atomic_init(&cache->pisano[i], NULL);
+  for (int i = 0; i < RECURRENCE_CACHE_SLOTS; i++)
+    atomic_init(&cache->recurrence[i], NULL);
+  atomic_init(&cache->retired, NULL);
+  atomic_init(&cache->num_retired, 0);
+  return cache;
+}
+
+void fib_query_cache_reclaim(fib_query_cache *cache)
+{
+  recurrence_entry *e = atomic_exchange(&cache->retired, NULL);
+  while (e) {
+    recurrence_entry *next = e->retired_next;
+    recurrence_free(e);
+    e = next;
+  }
+  atomic_store(&cache->num_retired, 0);
+}
+
+void fib_query_cache_destroy(fib_query_cache *cache)
+{
+  for (int i = 0; i < PISANO_CACHE_SLOTS; i++) {
+    pisano_entry *e = atomic_load(&cache->pisano[i]);
+    if (e) {
+      free(e->table);
+      free(e);
+    }
+  }
+  for (int i = 0; i < RECURRENCE_CACHE_SLOTS; i++) {
+    recurrence_entry *e = atomic_load(&cache->recurrence[i]);
+    if (e)
+      recurrence_free(e);
+  }
+  fib_query_cache_reclaim(cache);
+  free(cache);
+}
+
+static inline uint64_t mix_hash(uint64_t h, uint64_t v)
+{
+  h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  return h;
+}
+
+// Build the table of one full Pisano period for m. The period is at
+// most 6m, and the sequence mod m is back at (0, 1) when it ends.
+static pisano_entry *pisano_build(uint64_t m)
+{
+  pisano_entry *e = malloc(sizeof(pisano_entry));
+  e->m = m;
+  e->table = malloc(6 * m * sizeof(uint32_t));
+  uint64_t a = 0, b = 1 % m, i = 0;
+  do {
+    e->table[i++] = (uint32_t)a;
+    uint64_t c = addmod(a, b, m);
+    a = b;
+    b = c;
+  } while (!(a == 0 && b == 1 % m));
+  e->period = i;
+  return e;
+}
+
+// Return the cached Pisano table for m, building it on first use.
+// Returns NULL when m is too large to tabulate or its PISANO_PROBES
+// slots are taken by other moduli. Probing stops at the first empty
+// slot, where m is added.
+static pisano_entry *pisano_lookup(fib_query_cache *cache, uint64_t m)
+{
+  if (m > PISANO_MAX_MODULUS)
+    return NULL;
+  pisano_entry *built = NULL;
+  size_t slot = mix_hash(0, m) % PISANO_CACHE_SLOTS;
+  for (int probe = 0; probe < PISANO_PROBES; probe++) {
+    _Atomic(pisano_entry *) *cell = &cache->pisano[(slot + probe) % PISANO_CACHE_SLOTS];
+    pisano_entry *e = atomic_load_explicit(cell, memory_order_acquire);
+    if (e == NULL) {
+      if (built == NULL)
+        built = pisano_build(m);
+      if (atomic_compare_exchange_strong(cell, &e, built))
+        return built;
+    }
+    if (e->m == m) {
+      if (built) {
+        free(built->table);
+        free(built);
+      }
+      return e;
+    }
+  }
+  if (built) {
+    free(built->table);
+    free(built);
+  }
+  return NULL;
+}
+
+// r = a * b for order x order matrices mod m. r must not alias a or b.
+static void matrix_mul(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                       int order, const modulus *mod)
+{
+  for (int i = 0; i < order; i++) {
+    for (int j = 0; j < order; j++) {
+      uint64_t sum = 0;
+      for (int t = 0; t < order; t++)
+        sum = addmod(sum, mulmod(a[i * order + t], b[t * order + j], mod), mod->m);
+      r[i * order + j] = sum;
+    }
+  }
+}
+
+// v = a * v for an order x order matrix a mod m.
+static void matrix_apply(uint64_t *v, const uint64_t *a, int order, const modulus *mod)
+{
+  uint64_t next[RECURRENCE_MAX_ORDER];
+  for (int i = 0; i < order; i++) {
+    uint64_t sum = 0;
+    for (int t = 0; t < order; t++)
+      sum = addmod(sum, mulmod(a[i * order + t], v[t], mod), mod->m);
+    next[i] = sum;
+  }
+  memcpy(v, next, order * sizeof(uint64_t));
+}
+
+// Store the companion matrix C of
+//   x(i) = coeff[0] x(i-1) + ... + coeff[order-1] x(i-order)
+// in c. C acts on the state vector (x(i+order-1), ..., x(i)).
+static void companion_matrix(uint64_t *c, const fib_recurrence *r, const modulus *mod)
+{
+  int k = r->order;
+  memset(c, 0, k * k * sizeof(uint64_t));
+  for (int t = 0; t < k; t++)
+    c[t] = r->coeff[t] % mod->m;
+  for (int i = 1; i < k; i++)
+    c[i * k + i - 1] = 1 % mod->m;
+}
+
+// Build C^(2^j) for j < levels. The powers already in `from` (an entry
+// for the same recurrence, or NULL) are copied rather than recomputed.
+static recurrence_entry *recurrence_build(const fib_recurrence *r, const modulus *mod,
+                                          int levels, const recurrence_entry *from)
+{
+  int k = r->order;
+  size_t size = (size_t)k * k;
+  if (from && from->levels > levels)
+    levels = from->levels;
+  recurrence_entry *e = malloc(sizeof(recurrence_entry));
+  e->m = mod->m;
+  e->order = k;
+  e->levels = levels;
+  atomic_init(&e->referenced, 1);
+  memcpy(e->coeff, r->coeff, k * sizeof(uint64_t));
+  e->power = malloc(levels * size * sizeof(uint64_t));
+  e->retired_next = NULL;
+  int j = 1;
+  if (from) {
+    memcpy(e->power, from->power, from->levels * size * sizeof(uint64_t));
+    j = from->levels;
+  } else {
+    companion_matrix(e->power, r, mod);
+  }
+  for (; j < levels; j++)
+    matrix_mul(e->power + j * size, e->power + (j - 1) * size, e->power + (j - 1) * size, k, mod);
+  return e;
+}
+
+static int recurrence_matches(const recurrence_entry *e, const fib_recurrence *r,
+                              const modulus *mod)
+{
+  return e->m == mod->m && e->order == r->order &&
+         memcmp(e->coeff, r->coeff, r->order * sizeof(uint64_t)) == 0;
+}
+
+// Push a replaced entry onto the retired list.
+static void recurrence_retire(fib_query_cache *cache, recurrence_entry *e)
+{
+  e->retired_next = atomic_load_explicit(&cache->retired, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak(&cache->retired, &e->retired_next, e))
+    ;
+  atomic_fetch_add_explicit(&cache->num_retired, 1, memory_order_relaxed);
+}
+
+// Return shared matrix powers for recurrence r and the modulus with at
+// least `levels` of them, building, extending or evicting on a miss as
+// described above. Returns NULL when too many entries are waiting to be
+// reclaimed; the caller then computes the powers itself.
+static recurrence_entry *recurrence_lookup(fib_query_cache *cache,
+                                           const fib_recurrence *r, const modulus *mod,
+                                           int levels)
+{
+  uint64_t h = mix_hash(mod->m, r->order);
+  for (int t = 0; t < r->order; t++)
+    h = mix_hash(h, r->coeff[t]);
+  recurrence_entry *built = NULL;
+  size_t slot = h % RECURRENCE_CACHE_SLOTS;
+  _Atomic(recurrence_entry *) *victim = NULL;
+  for (int probe = 0; probe < RECURRENCE_PROBES; probe++) {
+    _Atomic(recurrence_entry *) *cell =
+        &cache->recurrence[(slot + probe) % RECURRENCE_CACHE_SLOTS];
+    recurrence_entry *e = atomic_load_explicit(cell, memory_order_acquire);
+    if (e == NULL) {
+      if (built == NULL)
+        built = recurrence_build(r, mod, levels, NULL);
+      if (atomic_compare_exchange_strong(cell, &e, built))
+        return built;
+    }
+    if (recurrence_matches(e, r, mod)) {
+      atomic_store_explicit(&e->referenced, 1, memory_order_relaxed);
+      if (e->levels >= levels) {
+        if (built)
+          recurrence_free(built);
+        return e;
+      }
+      victim = cell; // Too short: replace it with a longer copy
+      break;
+    }
+    if (victim == NULL &&
+        atomic_exchange_explicit(&e->referenced, 0, memory_order_relaxed) == 0)
+      victim = cell;
+  }
+  if (victim == NULL)
+    victim = &cache->recurrence[slot];
+
+  if (atomic_load_explicit(&cache->num_retired, memory_order_relaxed) >= RECURRENCE_CACHE_SLOTS) {
+    if (built)
+      recurrence_free(built);
+    return NULL;
+  }
+  recurrence_entry *old = atomic_load_explicit(victim, memory_order_acquire);
+  if (built == NULL)
+    built = recurrence_build(r, mod, levels, old && recurrence_matches(old, r, mod) ? old : NULL);
+  // If another worker changed the slot first, `built` is still good for
+  // this query; retiring it keeps it alive until the next reclaim.
+  if (atomic_compare_exchange_strong(victim, &old, built)) {
+    if (old)
+      recurrence_retire(cache, old);
+  } else {
+    recurrence_retire(cache, built);
+  }
+  return built;
+}
+
+// x(n) mod m by stepping the recurrence from its initial terms.
+static uint64_t recurrence_step(const fib_recurrence *r, uint64_t n, const modulus *mod)
+{
+  int k = r->order;
+  if (n < (uint64_t)k)
+    return r->init[n] % mod->m;
+  uint64_t coeff[RECURRENCE_MAX_ORDER], x[RECURRENCE_MAX_ORDER]; // x[t] = x(i-1-t)
+  for (int t = 0; t < k; t++) {
+    coeff[t] = r->coeff[t] % mod->m;
+    x[t] = r->init[k - 1 - t] % mod->m;
+  }
+  for (uint64_t i = k; i <= n; i++) {
+    uint64_t sum = 0;
+    for (int t = 0; t < k; t++)
+      sum = addmod(sum, mulmod(coeff[t], x[t], mod), mod->m);
+    memmove(x + 1, x, (k - 1) * sizeof(uint64_t));
+    x[0] = sum;
+  }
+  return x[0];
+}
+
+//***********************************************************************
+//
+// fib_query_answer
+//
+// Answer one batch query, looking up its recurrence (if any) in
+// `recurrences`. Fibonacci queries with a small modulus are
+// looked up in the cached Pisano table at n mod period; otherwise they
+// use fast doubling with Barrett reduction. General recurrences with
+// small n are stepped term by term. The rest multiply the initial state
+// vector by the cached C^(2^j) for each set bit j of n, which is
+// O(order^2) per bit instead of a full matrix power, or fall back to
+// square-and-multiply when the cache cannot take them.
+//
+//***********************************************************************
+uint64_t fib_query_answer(fib_query_cache *cache, const fib_query *q,
+                          const fib_recurrence *recurrences)
+{
+  modulus mod;
+  modulus_init(&mod, q->m);
+
+  if (q->recurrence == FIB_QUERY_FIBONACCI) {
+    pisano_entry *p = pisano_lookup(cache, q->m);
+    if (p)
+      return p->table[q->n % p->period];
+    uint64_t fn, fn1;
+    fib_mod_pair_r(q->n, &mod, &fn, &fn1);
+    return fn;
+  }
+
+  const fib_recurrence *r = &recurrences[q->recurrence];
+  int k = r->order;
+  if (q->n < (uint64_t)k * RECURRENCE_STEP_FACTOR)
+    return recurrence_step(r, q->n, &mod);
+
+  uint64_t state[RECURRENCE_MAX_ORDER];
+  for (int i = 0; i < k; i++)
+    state[i] = r->init[k - 1 - i] % q->m;
+  int levels = 64 - __builtin_clzll(q->n);
+  recurrence_entry *e = recurrence_lookup(cache, r, &mod, levels);
+  if (e) {
+    size_t size = (size_t)k * k;
+    for (int j = 0; j < levels; j++)
+      if ((q->n >> j) & 1)
+        matrix_apply(state, e->power + j * size, k, &mod);
+    return state[k - 1];
+  }
+
+  uint64_t power[2][RECURRENCE_MAX_ORDER * RECURRENCE_MAX_ORDER];
+  int cur = 0;
+  companion_matrix(power[cur], r, &mod);
+  for (uint64_t n = q->n; ; ) {
+    if (n & 1)
+      matrix_apply(state, power[cur], k, &mod);
+    n >>= 1;
+    if (n == 0)
+      break;
+    matrix_mul(power[!cur], power[cur], power[cur], k, &mod);
+    cur = !cur;
+  }
+  return state[k - 1];
+}
@@ -0,0 +1,103 @@
+#ifndef _FIBCORE_H_DEFINED_
+#define _FIBCORE_H_DEFINED_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Big integers are stored as little-endian arrays of base 10^9 limbs so
+// that printing a result is a straight walk over the limbs instead of a
+// quadratic binary-to-decimal conversion.
+#define BN_BASE 1000000000u
+#define BN_BASE_DIGITS 9
+
+// Operand size (in limbs) below which schoolbook multiplication beats
+// Karatsuba.
+#define KARATSUBA_CUTOFF 40
+
+typedef struct {
+  uint32_t *limb; // limb[0] is least significant
+  size_t len;     // Number of limbs in use; 0 represents zero
+  size_t cap;     // Number of limbs allocated
+} bignum;
+
+void bn_init(bignum *a);
+
+void bn_free(bignum *a);
+
+void bn_set_u32(bignum *a, uint32_t v);
+
+void bn_copy(bignum *dst, const bignum *src);
+
+void bn_swap(bignum *a, bignum *b);
+
+void bn_add(bignum *r, const bignum *a, const bignum *b);
+
+void bn_sub(bignum *r, const bignum *a, const bignum *b);
+
+void bn_mul(bignum *r, const bignum *a, const bignum *b);
+
+void bn_print(FILE *out, const bignum *a);
+
+void fib_big(bignum *f, uint64_t n);
+
+void fib_stream(FILE *out, uint64_t n);
+
+void fib_mod_pair(uint64_t k, uint64_t m, uint64_t *fk, uint64_t *fk1);
+
+size_t fib_mod_format(char *buf, uint64_t start, uint64_t count, uint64_t m);
+
+// Longest line fib_mod_format writes for one term (20 digits + '\n').
+#define FIB_MOD_LINE_MAX 21
+
+// Batch query limits. Moduli up to PISANO_MAX_MODULUS get a cached table
+// of one Pisano period; recurrences may have order up to
+// RECURRENCE_MAX_ORDER.
+#define PISANO_MAX_MODULUS 4096
+#define PISANO_CACHE_SLOTS 256
+#define RECURRENCE_MAX_ORDER 16
+#define RECURRENCE_CACHE_SLOTS 64
+
+// A linear recurrence x(i) = coeff[0] x(i-1) + ... + coeff[order-1]
+// x(i-order) with x(0..order-1) = init[0..order-1].
+typedef struct {
+  int order;
+  uint64_t coeff[RECURRENCE_MAX_ORDER];
+  uint64_t init[RECURRENCE_MAX_ORDER];
+} fib_recurrence;
+
+// One batch query: x(n) mod m, where x is the Fibonacci sequence if
+// `recurrence` is FIB_QUERY_FIBONACCI and otherwise entry `recurrence`
+// of the recurrence table passed to fib_query_answer. Keeping the
+// recurrence out of line holds a query to 24 bytes.
+typedef struct {
+  uint64_t n;
+  uint64_t m;
+  uint32_t recurrence;
+} fib_query;
+
+#define FIB_QUERY_FIBONACCI UINT32_MAX
+
+// Pisano tables and companion-matrix powers shared by all batch workers.
+typedef struct fib_query_cache fib_query_cache;
+
+fib_query_cache *fib_query_cache_create(void);
+
+void fib_query_cache_destroy(fib_query_cache *cache);
+
+// Free cache entries that have been replaced. Only call this while no
+// fib_query_answer is running on the cache, e.g. between batch blocks.
+void fib_query_cache_reclaim(fib_query_cache *cache);
+
+uint64_t fib_query_answer(fib_query_cache *cache, const fib_query *q,
+                          const fib_recurrence *recurrences);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
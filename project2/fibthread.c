@@ -1,40 +1,198 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "fibcore.h"
 
 #define MAX_LENGTH 90
 
+// Upper bound on the thread count for -p and -b. Thread handles live on
+// the stack, and -p keeps two CHUNK_TERMS buffers per thread.
+#define MAX_THREADS 256
+
+// Number of terms each thread formats per chunk in the parallel mode.
+#define CHUNK_TERMS 65536
+
+// Number of queries a batch worker claims at a time.
+#define QUERY_BLOCK 256
+
+// Number of queries the batch driver reads, answers and prints per
+// block, which bounds the batch mode's memory whatever the file size.
+#define BATCH_QUERIES 65536
+
+// Slots in the per-block table used to merge identical recurrences. A
+// power of two at least twice BATCH_QUERIES, so the table is never more
+// than half full and probes stay short.
+#define RECURRENCE_DEDUP_SLOTS (2 * BATCH_QUERIES)
+
 void *fib(void *);
 
+void *fib_index(void *);
+
+void *fib_sequence(void *);
+
+void *fib_range(void *);
+
+void *fib_batch(void *);
+
+// Argument block for the big-integer worker threads.
+typedef struct {
+  uint64_t n;
+  bignum result;
+} fib_big_args;
+
+// State shared by the parallel range workers. Chunks are handed out in
+// rounds of `num_threads`; two buffer sets let the workers fill round
+// r+1 while the main thread writes round r.
+typedef struct {
+  uint64_t n;
+  uint64_t modulus;
+  int num_threads;
+  uint64_t chunks;
+  uint64_t rounds;
+  char *chunk_buf[2];        // Per-chunk output, CHUNK_TERMS lines each
+  size_t *chunk_len[2];      // Bytes written to each chunk buffer
+  pthread_barrier_t round_done;
+} fib_range_state;
+
+// Per-worker argument for fib_range.
+typedef struct {
+  fib_range_state *state;
+  int id;
+} fib_range_args;
+
+int fib_parallel(uint64_t n, uint64_t modulus, int num_threads);
+
+// State shared by the batch query workers. The main thread fills one
+// block of up to BATCH_QUERIES queries, with the recurrences they use in
+// a separate table, and releases the workers through `block_ready`.
+// Workers claim QUERY_BLOCK queries at a time from `next_query` until
+// the block is exhausted, then meet the main thread at `block_done`.
+typedef struct {
+  fib_query *queries;
+  fib_recurrence *recurrences;
+  uint64_t *answers;
+  size_t num_queries;
+  size_t num_recurrences;
+  size_t recurrence_cap;
+  uint32_t *dedup;                        // Table index + 1, 0 if empty
+  atomic_size_t next_query;
+  int finished;                           // No more blocks; workers exit
+  fib_query_cache *cache;
+  pthread_barrier_t block_ready;
+  pthread_barrier_t block_done;
+} fib_batch_state;
+
+int fib_batch_file(const char *path, int num_threads);
+
 // Global array used to store computed Fibonacci values.
 long fib_numbers[MAX_LENGTH];
 
-int main(void)
+// Parse the unsigned decimal number at `p` into `out`, leaving `*end`
+// just past it. strtoull accepts a sign and wraps negative numbers, so
+// the number must start with a digit, and values past 2^64-1 are
+// rejected. Returns 1 on success, 0 otherwise.
+static int parse_u64(const char *p, char **end, uint64_t *out)
+{
+  if (*p < '0' || *p > '9')
+    return 0;
+  errno = 0;
+  *out = strtoull(p, end, 10);
+  return *end != p && errno != ERANGE;
+}
+
+// Parse a whole command-line argument as an unsigned decimal number,
+// with nothing after it. Reports a bad argument and returns 0.
+static int parse_arg(const char *arg, const char *what, uint64_t *out)
+{
+  char *end;
+  if (!parse_u64(arg, &end, out) || *end != '\0') {
+    fprintf(stderr, "Invalid %s: %s\n", what, arg);
+    return 0;
+  }
+  return 1;
+}
+
+int main(int argc, char *argv[])
 {
   //***********************************************************************
   //
   // Main Function
   //
-  // Prompts the user for how many Fibonacci numbers to generate (bounded
-  // by MAX_LENGTH), starts a worker thread to compute them, waits for the
-  // worker, and then prints the results.
+  // With no arguments, prompts the user for how many Fibonacci numbers to
+  // generate (bounded by MAX_LENGTH), starts a worker thread to compute
+  // them, waits for the worker, and then prints the results.
+  //
+  // The big-integer modes lift the MAX_LENGTH limit:
+  //   -i N   print the single value F(N), computed by fast doubling
+  //   -s N   stream F(0) .. F(N-1) without storing the sequence
+  //
+  // And for long sequences modulo m:
+  //   -p N M T  print F(0) .. F(N-1) mod M using T threads
+  //
+  // And for answering many queries at once:
+  //   -b FILE T  answer each "n m [k c1..ck a0..a(k-1)]" line in FILE
+  //              with a pool of T threads
   //
   //***********************************************************************
   /* local variables */
   pthread_t thread;
   pthread_attr_t attr;
   int n;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
+
+  if (argc == 3 && (strcmp(argv[1], "-i") == 0 || strcmp(argv[1], "-s") == 0)) {
+    fib_big_args args;
+    if (!parse_arg(argv[2], argv[1][1] == 'i' ? "index" : "count", &args.n))
+      return 1;
+    bn_init(&args.result);
+    if (argv[1][1] == 'i') {
+      pthread_create(&thread, &attr, fib_index, &args);
+      pthread_join(thread, NULL);
+      bn_print(stdout, &args.result);
+      bn_free(&args.result);
+    } else {
+      pthread_create(&thread, &attr, fib_sequence, &args);
+      pthread_join(thread, NULL);
+    }
+    return (0);
+  } else if (argc == 5 && strcmp(argv[1], "-p") == 0) {
+    uint64_t count, modulus, num_threads;
+    if (!parse_arg(argv[2], "count", &count) || !parse_arg(argv[3], "modulus", &modulus) ||
+        !parse_arg(argv[4], "thread count", &num_threads))
+      return 1;
+    if (modulus == 0 || num_threads == 0 || num_threads > MAX_THREADS) {
+      fprintf(stderr, "Modulus must be positive and thread count between 1 and %d.\n", MAX_THREADS);
+      return 1;
+    }
+    return fib_parallel(count, modulus, (int)num_threads);
+  } else if (argc == 4 && strcmp(argv[1], "-b") == 0) {
+    uint64_t num_threads;
+    if (!parse_arg(argv[3], "thread count", &num_threads))
+      return 1;
+    if (num_threads == 0 || num_threads > MAX_THREADS) {
+      fprintf(stderr, "Thread count must be between 1 and %d.\n", MAX_THREADS);
+      return 1;
+    }
+    return fib_batch_file(argv[2], (int)num_threads);
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: %s [-i N | -s N | -p N M T | -b FILE T]\n", argv[0]);
+    return 1;
+  }
+
   printf("Enter the number of Fibonacci numbers to generate (max %d): ", MAX_LENGTH);
   scanf("%d", &n);
 
   // Check for reasonable bounds
   if (n <= 0 || n >= MAX_LENGTH) {
     printf("Number out of bounds. Please enter a value between 1 and %d.\n", MAX_LENGTH);
+    printf("Use -s N to stream longer sequences.\n");
     return 1;
   }
-  
-  pthread_attr_init(&attr);
-  pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
 
   pthread_create(&thread, &attr, fib, (void *)&n);
   pthread_join(thread, NULL);
@@ -78,3 +236,333 @@ void *fib(void *s)
   pthread_exit(0);
 }
 
+void *fib_index(void *s)
+{
+  //***********************************************************************
+  //
+  // Single-index worker thread
+  //
+  // Computes F(n) for the `n` in the provided fib_big_args and stores it
+  // in the block's `result` for the main thread to print.
+  //
+  //***********************************************************************
+  fib_big_args *args = (fib_big_args *)s;
+  fib_big(&args->result, args->n);
+  pthread_exit(0);
+}
+
+void *fib_sequence(void *s)
+{
+  //***********************************************************************
+  //
+  // Streaming worker thread
+  //
+  // Prints the first `n` Fibonacci numbers as they are produced, holding
+  // only the two most recent terms in memory.
+  //
+  //***********************************************************************
+  fib_big_args *args = (fib_big_args *)s;
+  fib_stream(stdout, args->n);
+  pthread_exit(0);
+}
+
+int fib_parallel(uint64_t n, uint64_t modulus, int num_threads)
+{
+  //***********************************************************************
+  //
+  // Parallel range driver
+  //
+  // Splits [0, n) into CHUNK_TERMS-sized chunks and starts `num_threads`
+  // fib_range workers. Each chunk is seeded with fib_mod_pair, so no
+  // worker depends on another. After every round the main thread writes
+  // the round's chunk buffers to stdout in order, which keeps the output
+  // sequential and memory bounded by two rounds of buffers.
+  //
+  //***********************************************************************
+  fib_range_state state;
+  // Rounded up without n + CHUNK_TERMS - 1, which wraps near 2^64.
+  state.chunks = n / CHUNK_TERMS + (n % CHUNK_TERMS != 0);
+  state.n = n;
+  state.modulus = modulus;
+  state.num_threads = num_threads;
+  state.rounds = state.chunks / num_threads + (state.chunks % num_threads != 0);
+  int out_of_memory = 0;
+  for (int set = 0; set < 2; set++) {
+    state.chunk_buf[set] = malloc((size_t)num_threads * CHUNK_TERMS * FIB_MOD_LINE_MAX);
+    state.chunk_len[set] = calloc(num_threads, sizeof(size_t));
+    out_of_memory |= state.chunk_buf[set] == NULL || state.chunk_len[set] == NULL;
+  }
+  if (out_of_memory) {
+    fprintf(stderr, "Out of memory for %d threads' chunk buffers.\n", num_threads);
+    for (int set = 0; set < 2; set++) {
+      free(state.chunk_buf[set]);
+      free(state.chunk_len[set]);
+    }
+    return 1;
+  }
+  pthread_barrier_init(&state.round_done, NULL, num_threads + 1);
+
+  pthread_t threads[num_threads];
+  fib_range_args args[num_threads];
+  for (int i = 0; i < num_threads; i++) {
+    args[i].state = &state;
+    args[i].id = i;
+    pthread_create(&threads[i], NULL, fib_range, &args[i]);
+  }
+
+  for (uint64_t round = 0; round < state.rounds; round++) {
+    pthread_barrier_wait(&state.round_done);
+    int set = round & 1;
+    for (int i = 0; i < num_threads; i++) {
+      fwrite(state.chunk_buf[set] + (size_t)i * CHUNK_TERMS * FIB_MOD_LINE_MAX,
+             1, state.chunk_len[set][i], stdout);
+    }
+  }
+
+  for (int i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+  pthread_barrier_destroy(&state.round_done);
+  for (int set = 0; set < 2; set++) {
+    free(state.chunk_buf[set]);
+    free(state.chunk_len[set]);
+  }
+  return 0;
+}
+
+void *fib_range(void *s)
+{
+  //***********************************************************************
+  //
+  // Parallel range worker thread
+  //
+  // In each round, formats chunk (round * num_threads + id) into its slot
+  // of the current buffer set, then waits on the round barrier. A worker
+  // whose chunk lies past n records an empty slot so the main thread can
+  // still write every slot in order.
+  //
+  //***********************************************************************
+  fib_range_args *args = (fib_range_args *)s;
+  fib_range_state *state = args->state;
+  for (uint64_t round = 0; round < state->rounds; round++) {
+    int set = round & 1;
+    uint64_t chunk = round * state->num_threads + args->id;
+    uint64_t start = 0, count = 0;
+    // Compare chunk indices, not offsets: past the last chunk the offset
+    // can wrap around 2^64.
+    if (chunk < state->chunks) {
+      start = chunk * CHUNK_TERMS;
+      count = state->n - start < CHUNK_TERMS ? state->n - start : CHUNK_TERMS;
+    }
+    char *buf = state->chunk_buf[set] + (size_t)args->id * CHUNK_TERMS * FIB_MOD_LINE_MAX;
+    state->chunk_len[set][args->id] = count ? fib_mod_format(buf, start, count, state->modulus) : 0;
+    pthread_barrier_wait(&state->round_done);
+  }
+  pthread_exit(0);
+}
+
+// Parse one query line into `q`, and a recurrence line's parameters
+// into `r`. Returns 1 on success, 0 for a blank line and -1 for a
+// malformed one. r->order is 0 for a plain Fibonacci query.
+static int parse_query(const char *line, fib_query *q, fib_recurrence *r)
+{
+  uint64_t fields[3 + 2 * RECURRENCE_MAX_ORDER];
+  int count = 0;
+  const char *p = line;
+  char *end;
+  while (1) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+      p++;
+    if (*p == '\0')
+      break;
+    if (count == (int)(sizeof(fields) / sizeof(fields[0])))
+      return -1;
+    if (!parse_u64(p, &end, &fields[count++]))
+      return -1;
+    p = end;
+  }
+  if (count == 0)
+    return 0;
+  if (count < 2 || fields[1] == 0)
+    return -1;
+  q->n = fields[0];
+  q->m = fields[1];
+  q->recurrence = FIB_QUERY_FIBONACCI;
+  r->order = 0;
+  if (count == 2)
+    return 1;
+  if (fields[2] < 1 || fields[2] > RECURRENCE_MAX_ORDER)
+    return -1;
+  r->order = (int)fields[2];
+  if (count != 3 + 2 * r->order)
+    return -1;
+  for (int i = 0; i < r->order; i++) {
+    r->coeff[i] = fields[3 + i];
+    r->init[i] = fields[3 + r->order + i];
+  }
+  return 1;
+}
+
+// Index of `r` in the block's recurrence table, adding it if this block
+// has not seen it yet. Identical recurrence lines share one entry.
+static uint32_t intern_recurrence(fib_batch_state *state, const fib_recurrence *r)
+{
+  size_t bytes = r->order * sizeof(uint64_t);
+  uint64_t h = 0x9e3779b97f4a7c15ull * (r->order + 1);
+  for (int i = 0; i < r->order; i++)
+    h = (h ^ r->coeff[i] ^ (r->init[i] << 1)) * 0x100000001b3ull;
+  // At most one entry per query, so the table always has an empty slot
+  // and the probe ends there when `r` is new.
+  size_t slot = (h ^ (h >> 29)) & (RECURRENCE_DEDUP_SLOTS - 1);
+  uint32_t *cell;
+  while (*(cell = &state->dedup[slot]) != 0) {
+    const fib_recurrence *e = &state->recurrences[*cell - 1];
+    if (e->order == r->order && memcmp(e->coeff, r->coeff, bytes) == 0 &&
+        memcmp(e->init, r->init, bytes) == 0)
+      return *cell - 1;
+    slot = (slot + 1) & (RECURRENCE_DEDUP_SLOTS - 1);
+  }
+
+  if (state->num_recurrences == state->recurrence_cap) {
+    state->recurrence_cap = state->recurrence_cap ? 2 * state->recurrence_cap : 64;
+    state->recurrences = realloc(state->recurrences, state->recurrence_cap * sizeof(fib_recurrence));
+  }
+  uint32_t index = state->num_recurrences++;
+  state->recurrences[index] = *r;
+  *cell = index + 1;
+  return index;
+}
+
+// Read up to BATCH_QUERIES queries from `in` into the state's block,
+// starting a fresh recurrence table. Returns the number read. Reading
+// stops early at a malformed line, whose number is stored in
+// `*bad_line`; the queries before it are still returned.
+static long read_query_block(fib_batch_state *state, FILE *in,
+                             char **line, size_t *line_cap, int *line_no, int *bad_line)
+{
+  state->num_queries = 0;
+  state->num_recurrences = 0;
+  memset(state->dedup, 0, RECURRENCE_DEDUP_SLOTS * sizeof(uint32_t));
+  while (state->num_queries < BATCH_QUERIES && getline(line, line_cap, in) != -1) {
+    (*line_no)++;
+    fib_query *q = &state->queries[state->num_queries];
+    fib_recurrence r;
+    int parsed = parse_query(*line, q, &r);
+    if (parsed < 0) {
+      *bad_line = *line_no;
+      break;
+    }
+    if (parsed == 0)
+      continue;
+    if (r.order > 0)
+      q->recurrence = intern_recurrence(state, &r);
+    state->num_queries++;
+  }
+  return state->num_queries;
+}
+
+int fib_batch_file(const char *path, int num_threads)
+{
+  //***********************************************************************
+  //
+  // Batch query driver
+  //
+  // Starts one pool of `num_threads` fib_batch workers that share a
+  // single fib_query_cache, then works through `path` a block at a
+  // time: read up to BATCH_QUERIES queries, let the workers answer them,
+  // print the answers in input order and reuse the buffers for the next
+  // block, freeing any cache entries replaced during the block while
+  // the workers are idle. Memory stays bounded by one block however long
+  // the file is.
+  // On a malformed line, every query before it is answered and printed,
+  // then the line is reported and the driver stops with status 1.
+  //
+  //***********************************************************************
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  fib_batch_state state;
+  state.queries = malloc(BATCH_QUERIES * sizeof(fib_query));
+  state.answers = malloc(BATCH_QUERIES * sizeof(uint64_t));
+  state.dedup = malloc(RECURRENCE_DEDUP_SLOTS * sizeof(uint32_t));
+  state.recurrences = NULL;
+  state.recurrence_cap = 0;
+  state.finished = 0;
+  state.cache = fib_query_cache_create();
+  pthread_barrier_init(&state.block_ready, NULL, num_threads + 1);
+  pthread_barrier_init(&state.block_done, NULL, num_threads + 1);
+
+  pthread_t threads[num_threads];
+  for (int i = 0; i < num_threads; i++)
+    pthread_create(&threads[i], NULL, fib_batch, &state);
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  int line_no = 0;
+  int bad_line = 0;
+  while (1) {
+    long count = read_query_block(&state, in, &line, &line_cap, &line_no, &bad_line);
+    if (count > 0) {
+      atomic_store(&state.next_query, 0);
+      pthread_barrier_wait(&state.block_ready);
+      pthread_barrier_wait(&state.block_done);
+      fib_query_cache_reclaim(state.cache);
+      for (long i = 0; i < count; i++)
+        printf("%llu\n", (unsigned long long)state.answers[i]);
+    }
+    if (count == 0 || bad_line)
+      break;
+  }
+  if (bad_line) {
+    fflush(stdout);
+    fprintf(stderr, "%s:%d: invalid query\n", path, bad_line);
+  }
+  state.finished = 1;
+  pthread_barrier_wait(&state.block_ready);
+  for (int i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+
+  free(line);
+  fclose(in);
+  pthread_barrier_destroy(&state.block_ready);
+  pthread_barrier_destroy(&state.block_done);
+  fib_query_cache_destroy(state.cache);
+  free(state.recurrences);
+  free(state.answers);
+  free(state.dedup);
+  free(state.queries);
+  return bad_line != 0;
+}
+
+void *fib_batch(void *s)
+{
+  //***********************************************************************
+  //
+  // Batch query worker thread
+  //
+  // For each block, waits for the main thread to fill it, then claims
+  // the next QUERY_BLOCK queries at a time with an atomic fetch-and-add
+  // and answers them through the shared cache. When the block is
+  // exhausted it waits for the others, and it exits once the main thread
+  // reports there are no more blocks.
+  //
+  //***********************************************************************
+  fib_batch_state *state = (fib_batch_state *)s;
+  while (1) {
+    pthread_barrier_wait(&state->block_ready);
+    if (state->finished)
+      break;
+    while (1) {
+      size_t first = atomic_fetch_add(&state->next_query, QUERY_BLOCK);
+      if (first >= state->num_queries)
+        break;
+      size_t last = first + QUERY_BLOCK < state->num_queries ? first + QUERY_BLOCK : state->num_queries;
+      for (size_t i = first; i < last; i++)
+        state->answers[i] = fib_query_answer(state->cache, &state->queries[i], state->recurrences);
+    }
+    pthread_barrier_wait(&state->block_done);
+  }
+  pthread_exit(0);
+}
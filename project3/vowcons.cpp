@@ -1,154 +1,475 @@
-#include <pthread.h>
-#include <iostream>
-#include <vector>
-#include <string>
-#include <sstream>
-#include <cctype>
-#include <sched.h>
-
-using namespace std;
-
-// Global variables to store words and synchronization
-vector<string> words;
-pthread_mutex_t mutex;
-int index = 0; // Current index in the words vector
-
-//***********************************************************************
-//
-// Vowel Check Helper Function
-//
-// This function checks whether a word starts with a vowel
-// if the first character is a vowel, the return value is true.
-// Otherwise, the return value is false.
-//
-//***********************************************************************
-bool starts_with_vowel(const string& word) {
-    char first_char = tolower(word[0]);
-    return first_char == 'a' || first_char == 'e' || first_char == 'i' ||
-           first_char == 'o' || first_char == 'u';
-}
-
-//***********************************************************************
-//
-// Word Parsing Function
-//
-// This function takes a string of input and parses it into a vector
-// of individual words. Nothing is returned, since it modifies a global
-// variable containing the words
-//
-//***********************************************************************
-void parse_args(string line){
-    // Initialize local variales
-    stringstream liness(line);
-    string token;
-
-    // Parse the sstream into individual tokens, appending each one to 
-    // the global vector 'words'
-    while (getline(liness, token, ' ')) {
-        words.push_back(token);
-    }
-}
-
-//***********************************************************************
-//
-// Vowel-thread Function
-//
-// This thread function repeatedly selects the next unprocessed word from
-// the shared `words` vector and prints it if it starts with a vowel.
-// It uses `mutex` to synchronize access to the shared `index` and
-// returns when all words have been processed.
-//
-//***********************************************************************
-void* vow(void* arg) {
-    while (1) {
-        pthread_mutex_lock(&mutex);
-        if (index >= words.size()) {
-            pthread_mutex_unlock(&mutex);
-            return nullptr; // Exit if all words are processed
-        }
-        while (!starts_with_vowel(words[index])) {
-            pthread_mutex_unlock(&mutex);
-            sched_yield();  // Give CPU control to other thread
-            pthread_mutex_lock(&mutex);
-            if (index >= words.size()) {
-                pthread_mutex_unlock(&mutex);
-                return nullptr; // Exit if all words are processed
-            }
-        }
-
-        if (starts_with_vowel(words[index])) {
-            cout << "vow: " << words[index] << std::endl;
-            ++index;
-        } 
-        pthread_mutex_unlock(&mutex);
-        sched_yield();   
-    }
-}
-
-//***********************************************************************
-//
-// Consonant-thread Function
-//
-// This thread function repeatedly selects the next unprocessed word from
-// the shared `words` vector and prints it if it starts with a consonant.
-// It uses `mutex` to synchronize access to the shared `index` and
-// returns when all words have been processed.
-//
-//***********************************************************************
-void* cons(void* arg) {
-    while (1) {
-        pthread_mutex_lock(&mutex);
-        if (index >= words.size()) {
-            pthread_mutex_unlock(&mutex);
-            return nullptr; // Exit if all words are processed
-        }
-        while (starts_with_vowel(words[index])) {
-            pthread_mutex_unlock(&mutex);
-            sched_yield();  // Give CPU control to other thread
-            pthread_mutex_lock(&mutex);
-            if (index >= words.size()) {
-                pthread_mutex_unlock(&mutex);
-                return nullptr; // Exit if all words are processed
-            }
-        }
-        if (!starts_with_vowel(words[index])) {
-            cout << "cons: " << words[index] << std::endl;
-            ++index;
-        }
-    pthread_mutex_unlock(&mutex);
-    sched_yield();      
-    }
-}
-
-//***********************************************************************
-//
-// Main Function
-//
-// Reads a line of input from stdin, parses it into words, initializes
-// synchronization primitives, creates the vowel and consonant threads,
-// waits for them to finish, then cleans up and returns an exit code.
-//
-//***********************************************************************
-int main(void) {
-    // Read input line and parse into words
-    cout << "Enter a line of text: ";
-    string input_line;
-    getline(cin, input_line);
-    parse_args(input_line);
-
-    // Initialize mutex and condition variables
-    pthread_mutex_init(&mutex, nullptr);
-
-    // Create threads for vowel and consonant word printing
-    pthread_t thread_vow, thread_cons;
-    pthread_create(&thread_vow, nullptr, vow, nullptr);
-    pthread_create(&thread_cons, nullptr, cons, nullptr);
-
-    // Wait for both threads to finish
-    pthread_join(thread_vow, nullptr);
-    pthread_join(thread_cons, nullptr);
-
-    // Clean up mutex and condition variables
-    pthread_mutex_destroy(&mutex);
-    return 0;
-}
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#include <cstdlib>
+#include "wordscan.h"
+#include "../common/executor.h"
+
+using namespace std;
+
+// Upper bound on the classifier thread count
+#define MAX_THREADS 256
+
+// Bytes of input a classifier thread claims at a time
+#define CHUNK_BYTES (64 << 10)
+
+// Bytes of input tokenized and classified per window in streaming mode
+#define WINDOW_BYTES (8 << 20)
+
+// One slice of the current input, cut at whitespace, the words a
+// classifier found in it, and their formatted output. `out[0]` holds the
+// interleaved "vow: "/"cons: " lines, or only the vowel words when the
+// streams go to separate files; `out[1]` then holds the consonant words.
+struct chunk {
+    const char* begin;
+    const char* end;
+    word_scan scan;
+    string out[2];
+};
+
+// Global variables to store the work. In streaming mode `chunks` covers
+// only the current window; words are views into the input buffer.
+vowel_set vowels;                 // Letters that count as vowels
+vector<chunk> chunks;             // Reused across windows to keep capacity
+size_t num_chunks = 0;            // Chunks in use for the current input
+vector<future<void>> chunk_done;  // Ready once a chunk has been classified
+executor* classifiers;            // Pool shared by every window
+int out_fd[2] = { STDOUT_FILENO, -1 }; // Output files; [1] is set when split
+
+//***********************************************************************
+//
+// Input Splitting Function
+//
+// Cuts [begin, end) into chunks of about CHUNK_BYTES, extending each one
+// to the next whitespace byte so no word straddles two chunks. Sets
+// `num_chunks`; the chunks' scans are reset when they are classified.
+//
+//***********************************************************************
+void split_input(const char* begin, const char* end) {
+    num_chunks = 0;
+    const char* p = begin;
+    while (p < end) {
+        const char* chunk_end = p + min<size_t>(CHUNK_BYTES, end - p);
+        while (chunk_end < end && !isspace((unsigned char)*chunk_end)) ++chunk_end;
+        if (num_chunks == chunks.size()) chunks.emplace_back();
+        chunks[num_chunks].begin = p;
+        chunks[num_chunks].end = chunk_end;
+        ++num_chunks;
+        p = chunk_end;
+    }
+}
+
+//***********************************************************************
+//
+// Output Formatting Function
+//
+// Fills the chunk's output buffers from its scan, merging the vowel and
+// consonant index lists back into input order. With split output the
+// prefixes are dropped and each stream gets its own buffer.
+//
+//***********************************************************************
+void format_chunk(chunk& c) {
+    const word_scan& scan = c.scan;
+    bool split = out_fd[1] >= 0;
+    c.out[0].clear();
+    c.out[1].clear();
+    c.out[0].reserve((c.end - c.begin) + 6 * scan.words.size());
+
+    if (split) {
+        for (uint32_t i : scan.vowel_words) {
+            c.out[0].append(scan.words[i]).push_back('\n');
+        }
+        for (uint32_t i : scan.consonant_words) {
+            c.out[1].append(scan.words[i]).push_back('\n');
+        }
+        return;
+    }
+
+    size_t v = 0, n = 0;
+    while (v < scan.vowel_words.size() || n < scan.consonant_words.size()) {
+        if (n == scan.consonant_words.size() ||
+            (v < scan.vowel_words.size() && scan.vowel_words[v] < scan.consonant_words[n]))
+            c.out[0].append("vow: ").append(scan.words[scan.vowel_words[v++]]).push_back('\n');
+        else
+            c.out[0].append("cons: ").append(scan.words[scan.consonant_words[n++]]).push_back('\n');
+    }
+}
+
+//***********************************************************************
+//
+// Classifier Task Function
+//
+// Runs on the classifier pool, one task per chunk. The chunk is
+// tokenized and classified in one pass by scan_words and its output
+// lines are formatted into the chunk's own buffers, so no lock is taken
+// and no I/O happens here.
+//
+//***********************************************************************
+void classify(chunk& c) {
+    c.scan.clear();
+    scan_words(c.begin, c.end, vowels, c.scan);
+    format_chunk(c);
+}
+
+// Write every byte described by `iov` to `fd`, continuing after partial
+// writes. Returns false on error.
+bool write_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+//***********************************************************************
+//
+// Output Stage
+//
+// Runs on the main thread while the classifiers work and is the only
+// thread that writes. Waits on the next chunk's future in order, then
+// takes every consecutive chunk that is already done and writes all of
+// their buffers with one writev per output file. Chunks are only ever written
+// in input order, so the interleaved vow/cons ordering is unchanged.
+// Returns false if a write fails.
+//
+//***********************************************************************
+bool print_in_order() {
+    size_t index = 0;
+    vector<struct iovec> iov[2];
+    while (index < num_chunks) {
+        chunk_done[index].wait();
+        size_t ready = index + 1;
+        while (ready < num_chunks && ready - index < IOV_MAX &&
+               chunk_done[ready].wait_for(chrono::seconds(0)) == future_status::ready) ++ready;
+
+        for (int stream = 0; stream < 2 && out_fd[stream] >= 0; ++stream) {
+            iov[stream].clear();
+            for (size_t i = index; i < ready; ++i) {
+                string& out = chunks[i].out[stream];
+                if (!out.empty()) iov[stream].push_back({ out.data(), out.size() });
+            }
+            if (!write_all(out_fd[stream], iov[stream].data(), iov[stream].size())) {
+                perror("write");
+                return false;
+            }
+        }
+        index = ready;
+    }
+    return true;
+}
+
+//***********************************************************************
+//
+// classify_words
+//
+// Classifies and prints the words in [begin, end) on the classifier
+// pool, returning once everything has been printed. Called once in line
+// mode and once per window in streaming mode. Returns false if the
+// output could not be written.
+//
+//***********************************************************************
+bool classify_words(const char* begin, const char* end) {
+    split_input(begin, end);
+
+    // Queue one task per chunk and print results as they finish
+    chunk_done.clear();
+    for (size_t i = 0; i < num_chunks; ++i) {
+        chunk& c = chunks[i];
+        chunk_done.push_back(classifiers->submit([&c] { classify(c); }));
+    }
+    bool written = print_in_order();
+
+    // A failed write can leave tasks running; they still use `chunks`
+    for (auto& done : chunk_done) done.wait();
+    return written;
+}
+
+// Length of the prefix of [begin, end) that ends on a whitespace byte,
+// so a window never splits a word. Returns 0 if there is no whitespace.
+size_t whole_words_length(const char* begin, const char* end) {
+    const char* p = end;
+    while (p > begin && !isspace((unsigned char)p[-1])) --p;
+    return p - begin;
+}
+
+// Write [begin, end) of a word to output `stream`, after `prefix` and,
+// if `last`, followed by its newline. Returns false if the write failed.
+bool write_word_piece(int stream, const char* prefix, const char* begin, const char* end, bool last) {
+    struct iovec iov[3];
+    int count = 0;
+    if (*prefix) iov[count++] = { const_cast<char*>(prefix), strlen(prefix) };
+    if (end > begin) iov[count++] = { const_cast<char*>(begin), (size_t)(end - begin) };
+    if (last) iov[count++] = { const_cast<char*>("\n"), 1 };
+    if (!write_all(out_fd[stream], iov, count)) {
+        perror("write");
+        return false;
+    }
+    return true;
+}
+
+// Start a word that does not fit in one window: classify it by its
+// first letter, then write its prefix and the bytes in [begin, end).
+// Returns the output stream for the rest of the word, or -1 if the
+// write failed.
+int begin_long_word(const char* begin, const char* end) {
+    bool vowel = starts_with_vowel(string_view(begin, end - begin), vowels);
+    bool split = out_fd[1] >= 0;
+    int stream = split && !vowel ? 1 : 0;
+    const char* prefix = split ? "" : vowel ? "vow: " : "cons: ";
+    return write_word_piece(stream, prefix, begin, end, false) ? stream : -1;
+}
+
+//***********************************************************************
+//
+// stream_file
+//
+// Streaming mode: classifies the words of `path` (or stdin for "-") in
+// windows of at most WINDOW_BYTES, so memory stays bounded regardless of
+// input size. Regular files are mmapped and each window is scanned
+// straight out of the mapping; pages are released with madvise once
+// the window is printed. Anything that cannot be mapped (pipes, ttys) is
+// read into a reusable buffer instead until it holds a window, carrying
+// a partial trailing word over to the next window. Windows end after
+// their last whitespace byte; a word longer than a whole window is
+// written out a window at a time as it is read, instead of being held
+// whole. Returns an exit code.
+//
+//***********************************************************************
+int stream_file(const char* path) {
+    int fd = string(path) == "-" ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    bool written = true;
+    if (map != MAP_FAILED) {
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(map);
+        const char* end = data + st.st_size;
+        const char* window = data;
+        long page = sysconf(_SC_PAGESIZE);
+        // Drop the fully processed pages of [from, to) from this
+        // process's mapping
+        auto release = [&](const char* from, const char* to) {
+            const char* release_to = data + ((to - data) / page) * page;
+            const char* release_from = data + ((from - data) / page) * page;
+            if (release_to > release_from)
+                madvise(const_cast<char*>(release_from), release_to - release_from, MADV_DONTNEED);
+        };
+        while (written && window < end) {
+            // End the window after its last whitespace (including the
+            // byte just past it) so no word is split
+            const char* limit = window + min<size_t>(WINDOW_BYTES, end - window);
+            const char* window_end = limit == end ? end : window + whole_words_length(window, limit + 1);
+
+            if (window_end > window) {
+                written = classify_words(window, window_end);
+            } else {
+                // One word fills the whole window
+                int stream = begin_long_word(window, limit);
+                window_end = limit;
+                while (stream >= 0) {
+                    release(window, window_end);
+                    const char* piece_end = window_end + min<size_t>(WINDOW_BYTES, end - window_end);
+                    const char* word_end = window_end;
+                    while (word_end < piece_end && !isspace((unsigned char)*word_end)) ++word_end;
+                    bool last = word_end < piece_end || word_end == end;
+                    if (!write_word_piece(stream, "", window_end, word_end, last)) stream = -1;
+                    window_end = word_end;
+                    if (last) break;
+                }
+                written = stream >= 0;
+            }
+
+            release(window, window_end);
+            window = window_end;
+        }
+        munmap(map, st.st_size);
+    } else {
+        // The buffer never grows past one window; see long_word below.
+        vector<char> buffer(WINDOW_BYTES);
+        size_t filled = 0;
+        int long_word = -1;   // Output stream of a word being written in pieces
+        while (written) {
+            ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0) {
+                perror(path);
+                if (fd != STDIN_FILENO) close(fd);
+                return 1;
+            }
+            filled += n;
+            bool eof = n == 0;
+
+            // A pipe read returns at most a pipe buffer (about one chunk),
+            // so keep reading until a whole window is buffered; otherwise
+            // each classify_words call would keep only one worker busy.
+            if (!eof && filled < buffer.size()) continue;
+
+            // Finish or continue a word that did not fit in a window
+            if (long_word >= 0) {
+                size_t word_end = 0;
+                while (word_end < filled && !isspace((unsigned char)buffer[word_end])) ++word_end;
+                bool last = word_end < filled || eof;
+                written = write_word_piece(long_word, "", buffer.data(), buffer.data() + word_end, last);
+                copy(buffer.begin() + word_end, buffer.begin() + filled, buffer.begin());
+                filled -= word_end;
+                if (last) long_word = -1;
+            }
+
+            // At EOF everything left is whole words; otherwise hold back
+            // a trailing partial word for the next read.
+            if (written && long_word < 0) {
+                size_t usable = eof ? filled : whole_words_length(buffer.data(), buffer.data() + filled);
+                if (usable > 0) {
+                    written = classify_words(buffer.data(), buffer.data() + usable);
+                    copy(buffer.begin() + usable, buffer.begin() + filled, buffer.begin());
+                    filled -= usable;
+                } else if (filled == buffer.size()) {
+                    // One word fills the whole window
+                    long_word = begin_long_word(buffer.data(), buffer.data() + filled);
+                    written = long_word >= 0;
+                    filled = 0;
+                }
+            }
+            if (eof) break;
+        }
+    }
+
+    if (fd != STDIN_FILENO) close(fd);
+    return written ? 0 : 1;
+}
+
+void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [-l lang | -v vowels] [-o prefix] [-f file] [num_threads]" << endl;
+    cerr << "num_threads must be between 1 and " << MAX_THREADS << endl;
+}
+
+// Parse a thread count in [1, MAX_THREADS]: plain digits only, with no
+// sign or trailing characters. Returns false otherwise.
+bool parse_threads(const char* arg, int* out) {
+    if (*arg < '0' || *arg > '9') return false;
+    errno = 0;
+    char* end;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < 1 || value > MAX_THREADS) return false;
+    *out = (int)value;
+    return true;
+}
+
+//***********************************************************************
+//
+// Main Function
+//
+// In line mode (the default), reads a line of input from stdin; with
+// `-f FILE` the file is classified in streaming mode instead. With
+// `-o PREFIX` vowel and consonant words are written without prefixes to
+// PREFIX.vow and PREFIX.cons instead of stdout. The vowel
+// set defaults to English and can be chosen with `-l LANG` or given
+// directly with `-v VOWELS`. The optional last argument sets the number
+// of classifier threads, 1 to MAX_THREADS, and defaults to the number of
+// online CPUs.
+// Starts the classifier pool, classifies and prints the words, then
+// shuts the pool down and returns an exit code.
+//
+//***********************************************************************
+int main(int argc, char* argv[]) {
+    const char* stream_path = nullptr;
+    const char* split_prefix = nullptr;
+    const char* vowel_letters = vowel_set_preset("en");
+    int arg = 1;
+    while (argc > arg + 1 && argv[arg][0] == '-' && argv[arg][1] != '\0' && argv[arg][2] == '\0') {
+        char option = argv[arg][1];
+        if (option == 'f') {
+            stream_path = argv[arg + 1];
+        } else if (option == 'l') {
+            vowel_letters = vowel_set_preset(argv[arg + 1]);
+            if (vowel_letters == nullptr) {
+                cerr << "Unknown language: " << argv[arg + 1] << endl;
+                return 1;
+            }
+        } else if (option == 'v') {
+            vowel_letters = argv[arg + 1];
+        } else if (option == 'o') {
+            split_prefix = argv[arg + 1];
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (!vowel_set_init(vowels, vowel_letters)) {
+        cerr << "Vowels must be valid UTF-8" << endl;
+        return 1;
+    }
+    int num_threads = (int)min<long>(max<long>(sysconf(_SC_NPROCESSORS_ONLN), 1), MAX_THREADS);
+    if (argc > arg && (argc > arg + 1 || !parse_threads(argv[arg], &num_threads))) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (split_prefix) {
+        string vow_path = string(split_prefix) + ".vow";
+        string cons_path = string(split_prefix) + ".cons";
+        out_fd[0] = open(vow_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        out_fd[1] = open(cons_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd[0] < 0 || out_fd[1] < 0) {
+            perror(out_fd[0] < 0 ? vow_path.c_str() : cons_path.c_str());
+            return 1;
+        }
+    }
+
+    executor pool(num_threads);
+    classifiers = &pool;
+
+    int status = 0;
+    if (stream_path) {
+        status = stream_file(stream_path);
+    } else {
+        // Read input line and classify its words
+        cout << "Enter a line of text: ";
+        string input_line;
+        getline(cin, input_line);
+        cout.flush();
+        if (!classify_words(input_line.data(), input_line.data() + input_line.size()))
+            status = 1;
+    }
+
+    if (split_prefix) {
+        close(out_fd[0]);
+        close(out_fd[1]);
+    }
+
+    pool.shutdown();
+    return status;
+}
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cstring>
+#include "wordscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORDSCAN_X86 1
+#endif
+
+using namespace std;
+
+// Bytes examined per whitespace mask
+#define SCAN_BLOCK 32
+
+//***********************************************************************
+//
+// UTF-8 Helpers
+//
+//***********************************************************************
+
+// Decode the UTF-8 sequence at [p, end) into *cp and return its length,
+// or 0 if the sequence is malformed or truncated.
+static size_t utf8_decode(const unsigned char* p, const unsigned char* end, uint32_t* cp) {
+    size_t len;
+    uint32_t c = p[0];
+    if (c < 0x80) { *cp = c; return 1; }
+    else if (c >= 0xC2 && c <= 0xDF) { len = 2; c &= 0x1F; }
+    else if (c >= 0xE0 && c <= 0xEF) { len = 3; c &= 0x0F; }
+    else if (c >= 0xF0 && c <= 0xF4) { len = 4; c &= 0x07; }
+    else return 0;
+    if ((size_t)(end - p) < len) return 0;
+    for (size_t i = 1; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+    *cp = c;
+    return len;
+}
+
+// Lowercase the upper-case letters of Latin-1 (including Ÿ, whose
+// lower case ÿ is in Latin-1), Latin Extended-A, basic Greek and
+// Cyrillic, which covers the built-in language presets. Other code
+// points are returned unchanged.
+static uint32_t fold_case(uint32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') return cp + 0x20;
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) return cp + 0x20;
+    if (cp == 0x386) return 0x3AC;
+    if (cp >= 0x388 && cp <= 0x38A) return cp + 0x25;
+    if (cp == 0x38C) return 0x3CC;
+    if (cp == 0x38E || cp == 0x38F) return cp + 0x3F;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    // Latin Extended-A pairs each upper-case letter with the next code
+    // point: at even code points in 0x100-0x137 and 0x14A-0x177, and at
+    // odd ones in 0x139-0x148 and 0x179-0x17E.
+    if (((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177)) && !(cp & 1)) return cp + 1;
+    if (((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) && (cp & 1)) return cp + 1;
+    if (cp == 0x178) return 0xFF;
+    return cp;
+}
+
+//***********************************************************************
+//
+// vowel_set_init
+//
+// Build `set` from the UTF-8 string `vowels`, e.g. "aeiou" or
+// "aeiouäöü". Letters match in either case. Returns false if `vowels` is
+// not valid UTF-8.
+//
+//***********************************************************************
+bool vowel_set_init(vowel_set& set, string_view vowels) {
+    memset(set.first_byte, FIRST_CONSONANT, sizeof(set.first_byte));
+    set.codepoints.clear();
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(vowels.data());
+    const unsigned char* end = p + vowels.size();
+    while (p < end) {
+        uint32_t cp;
+        size_t len = utf8_decode(p, end, &cp);
+        if (len == 0) return false;
+        if (cp < 0x80) {
+            set.first_byte[cp] = FIRST_VOWEL;
+            if (cp >= 'a' && cp <= 'z') set.first_byte[cp - 0x20] = FIRST_VOWEL;
+            if (cp >= 'A' && cp <= 'Z') set.first_byte[cp + 0x20] = FIRST_VOWEL;
+        } else {
+            set.codepoints.push_back(fold_case(cp));
+        }
+        p += len;
+    }
+    sort(set.codepoints.begin(), set.codepoints.end());
+    set.codepoints.erase(unique(set.codepoints.begin(), set.codepoints.end()), set.codepoints.end());
+
+    // Any lead byte could begin an upper- or lower-case form of a listed
+    // vowel, so every valid lead byte is sent to the decoder.
+    if (!set.codepoints.empty()) {
+        for (int b = 0xC2; b <= 0xF4; b++) set.first_byte[b] = FIRST_DECODE;
+    }
+    return true;
+}
+
+//***********************************************************************
+//
+// vowel_set_preset
+//
+// Return the vowels for a language code, or nullptr if there is no
+// preset for it.
+//
+//***********************************************************************
+const char* vowel_set_preset(string_view language) {
+    static const struct { const char* language; const char* vowels; } presets[] = {
+        { "en", "aeiou" },
+        { "es", "aeiouáéíóúü" },
+        { "fr", "aeiouyàâæéèêëîïôœùûüÿ" },
+        { "de", "aeiouäöü" },
+        { "it", "aeiouàèéìíîòóùú" },
+        { "ru", "аеёиоуыэюя" },
+        { "el", "αεηιουωάέήίόύώ" },
+    };
+    for (auto& preset : presets) {
+        if (language == preset.language) return preset.vowels;
+    }
+    return nullptr;
+}
+
+//***********************************************************************
+//
+// Vowel Check Helper Function
+//
+// This function checks whether a word starts with a vowel from `set`.
+// ASCII first bytes are answered straight from the table; multi-byte
+// first letters are decoded and looked up. Empty words and malformed
+// UTF-8 count as consonants.
+//
+//***********************************************************************
+bool starts_with_vowel(string_view word, const vowel_set& set) {
+    if (word.empty()) return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(word.data());
+    unsigned char kind = set.first_byte[p[0]];
+    if (kind != FIRST_DECODE) return kind == FIRST_VOWEL;
+    uint32_t cp;
+    if (utf8_decode(p, p + word.size(), &cp) == 0) return false;
+    return binary_search(set.codepoints.begin(), set.codepoints.end(), fold_case(cp));
+}
+
+//***********************************************************************
+//
+// Scanner Core
+//
+// The kernels below differ only in how they produce a whitespace bitmask
+// for a block of bytes (bit i set if byte i is ' ', '\t', '\n', '\v',
+// '\f' or '\r'). scan_mask turns each mask into word boundaries: bits
+// where the "inside a word" state flips are found with a single XOR
+// against the mask shifted by one, and are then visited with
+// count-trailing-zeros, so the cost is per word rather than per byte.
+// Only ASCII bytes are whitespace, so multi-byte UTF-8 letters are never
+// split.
+//
+//***********************************************************************
+struct scan_state {
+    const char* word_start;
+    bool in_word;
+};
+
+static inline void emit_word(const char* word, const char* end, const vowel_set& set, word_scan& out) {
+    uint32_t index = out.words.size();
+    string_view w(word, end - word);
+    out.words.push_back(w);
+    if (starts_with_vowel(w, set))
+        out.vowel_words.push_back(index);
+    else
+        out.consonant_words.push_back(index);
+}
+
+static inline void scan_mask(const char* base, uint32_t space_mask, int width,
+                             scan_state& state, const vowel_set& set, word_scan& out) {
+    uint32_t width_mask = width == 32 ? 0xFFFFFFFFu : (1u << width) - 1;
+    uint32_t word_mask = ~space_mask & width_mask;
+    uint32_t flips = (word_mask ^ ((word_mask << 1) | (uint32_t)state.in_word)) & width_mask;
+    while (flips) {
+        int i = __builtin_ctz(flips);
+        if (word_mask & (1u << i))
+            state.word_start = base + i;
+        else
+            emit_word(state.word_start, base + i, set, out);
+        flips &= flips - 1;
+    }
+    state.in_word = (word_mask >> (width - 1)) & 1;
+}
+
+static const bool* space_table() {
+    static bool table[256] = {};
+    table[(unsigned char)' '] = table[(unsigned char)'\t'] = table[(unsigned char)'\n'] = true;
+    table[(unsigned char)'\v'] = table[(unsigned char)'\f'] = table[(unsigned char)'\r'] = true;
+    return table;
+}
+
+static inline uint32_t space_mask_scalar(const char* p, int width) {
+    static const bool* is_space = space_table();
+    uint32_t mask = 0;
+    for (int i = 0; i < width; i++)
+        mask |= (uint32_t)is_space[(unsigned char)p[i]] << i;
+    return mask;
+}
+
+// Finish a scan: the tail shorter than a block goes through the scalar
+// mask, and a word running into `end` is emitted.
+static inline void scan_tail(const char* p, const char* end, scan_state& state,
+                             const vowel_set& set, word_scan& out) {
+    if (p < end) {
+        int width = end - p;
+        scan_mask(p, space_mask_scalar(p, width), width, state, set, out);
+    }
+    if (state.in_word) emit_word(state.word_start, end, set, out);
+}
+
+static void scan_scalar(const char* p, const char* end, const vowel_set& set, word_scan& out) {
+    scan_state state = { p, false };
+    for (; end - p >= SCAN_BLOCK; p += SCAN_BLOCK)
+        scan_mask(p, space_mask_scalar(p, SCAN_BLOCK), SCAN_BLOCK, state, set, out);
+    scan_tail(p, end, state, set, out);
+}
+
+#ifdef WORDSCAN_X86
+// Whitespace is ' ' or a byte in '\t'..'\r'; the range test is done as
+// an unsigned compare of (byte - '\t') against 4 via min_epu8.
+__attribute__((target("sse2")))
+static inline uint32_t space_mask_sse2(const char* p) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    uint32_t mask = 0;
+    for (int half = 0; half < 2; half++) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * half));
+        __m128i shifted = _mm_sub_epi8(v, tab);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted);
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space), in_range);
+        mask |= (uint32_t)_mm_movemask_epi8(ws) << (16 * half);
+    }
+    return mask;
+}
+
+__attribute__((target("sse2")))
+static void scan_sse2(const char* p, const char* end, const vowel_set& set, word_scan& out) {
+    scan_state state = { p, false };
+    for (; end - p >= SCAN_BLOCK; p += SCAN_BLOCK)
+        scan_mask(p, space_mask_sse2(p), SCAN_BLOCK, state, set, out);
+    scan_tail(p, end, state, set, out);
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(const char* p, const char* end, const vowel_set& set, word_scan& out) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    scan_state state = { p, false };
+    for (; end - p >= SCAN_BLOCK; p += SCAN_BLOCK) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i shifted = _mm256_sub_epi8(v, tab);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, four), shifted);
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), in_range);
+        scan_mask(p, (uint32_t)_mm256_movemask_epi8(ws), SCAN_BLOCK, state, set, out);
+    }
+    scan_tail(p, end, state, set, out);
+}
+#endif
+
+typedef void (*scan_fn)(const char*, const char*, const vowel_set&, word_scan&);
+
+struct scan_kernel {
+    scan_fn fn;
+    const char* isa;
+};
+
+// Pick the widest kernel the CPU supports, once.
+static const scan_kernel& select_kernel() {
+    static const scan_kernel kernel = [] {
+#ifdef WORDSCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return scan_kernel{ scan_avx2, "avx2" };
+        if (__builtin_cpu_supports("sse2")) return scan_kernel{ scan_sse2, "sse2" };
+        return scan_kernel{ scan_scalar, "scalar" };
+#else
+        return scan_kernel{ scan_scalar, "scalar" };
+#endif
+    }();
+    return kernel;
+}
+
+//***********************************************************************
+//
+// scan_words
+//
+// Append every whitespace-separated word in [begin, end) to `out`,
+// classified by its first letter against `set`. Uses the AVX2 kernel
+// when the CPU has it, SSE2 otherwise on x86, and the scalar kernel
+// elsewhere.
+//
+//***********************************************************************
+void scan_words(const char* begin, const char* end, const vowel_set& set, word_scan& out) {
+    select_kernel().fn(begin, end, set, out);
+}
+
+// Name of the kernel scan_words dispatches to, for diagnostics.
+const char* scan_words_isa() {
+    return select_kernel().isa;
+}
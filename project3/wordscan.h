@@ -0,0 +1,46 @@
+#ifndef _WORDSCAN_H_DEFINED_
+#define _WORDSCAN_H_DEFINED_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Set of letters that count as vowels. ASCII letters are matched
+// case-insensitively through a table indexed by a word's first byte;
+// lead bytes of multi-byte UTF-8 vowels map to "decode", and the decoded
+// code point is looked up in `codepoints`.
+struct vowel_set {
+    unsigned char first_byte[256];      // FIRST_CONSONANT, FIRST_VOWEL or FIRST_DECODE
+    std::vector<uint32_t> codepoints;   // Sorted, case-folded non-ASCII vowels
+};
+
+#define FIRST_CONSONANT 0
+#define FIRST_VOWEL 1
+#define FIRST_DECODE 2
+
+// Words found by scan_words, as views into the scanned buffer, and the
+// indexes of those starting with a vowel and with anything else. Both
+// index lists are in ascending order.
+struct word_scan {
+    std::vector<std::string_view> words;
+    std::vector<uint32_t> vowel_words;
+    std::vector<uint32_t> consonant_words;
+
+    void clear() {
+        words.clear();
+        vowel_words.clear();
+        consonant_words.clear();
+    }
+};
+
+bool vowel_set_init(vowel_set& set, std::string_view vowels);
+
+const char* vowel_set_preset(std::string_view language);
+
+bool starts_with_vowel(std::string_view word, const vowel_set& set);
+
+void scan_words(const char* begin, const char* end, const vowel_set& set, word_scan& out);
+
+const char* scan_words_isa();
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef _ASYNC_BUFFER_H_DEFINED_
+#define _ASYNC_BUFFER_H_DEFINED_
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include "../common/executor.h"
+
+//***********************************************************************
+//
+// async_task
+//
+// Fire-and-forget coroutine. It does not start when called; spawn()
+// queues its first step on an executor, and every later step runs on
+// whichever worker resumes it. The frame frees itself when the body
+// returns. Completion is signalled by the body itself (e.g. a counter
+// and a promise), since nothing can wait on an async_task.
+//
+//***********************************************************************
+struct async_task {
+    struct promise_type {
+        async_task get_return_object() {
+            return async_task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+inline void spawn(executor& pool, async_task task) {
+    pool.post([h = task.handle] { h.resume(); });
+}
+
+//***********************************************************************
+//
+// async_buffer
+//
+// Bounded buffer for coroutines, the awaitable counterpart of the
+// semaphore + mutex buffer in buffer.cpp:
+//
+//   if (!co_await q.push(item)) ...          // false once closed
+//   std::optional<T> item = co_await q.pop(); // nullopt once closed and empty
+//
+// A push into a full buffer or a pop from an empty one suspends the
+// coroutine instead of blocking its thread. The awaiter itself (in the
+// coroutine frame) is linked into a FIFO of waiters, so waiting
+// allocates nothing. The operation that makes room or supplies an item
+// completes the waiter's half of the handoff under the lock, then posts
+// the waiter to the executor to carry on. That is a queue push on the
+// waking worker, with no syscall unless a worker is asleep and has to be
+// woken. Producers and consumers therefore never hold a thread while
+// waiting, and thousands of them can share a few workers.
+//
+// close() wakes every waiter: blocked pushes return false and blocked
+// pops return nullopt. Items already in the buffer can still be popped.
+//
+//***********************************************************************
+template <typename T>
+class async_buffer {
+    struct waiter {
+        std::coroutine_handle<> handle;
+        waiter* next = nullptr;
+    };
+
+    // Intrusive FIFO of suspended awaiters.
+    template <typename W>
+    struct waiter_list {
+        W* first = nullptr;
+        W* last = nullptr;
+
+        bool empty() const { return first == nullptr; }
+
+        void push_back(W* w) {
+            w->next = nullptr;
+            if (last) last->next = w;
+            else first = w;
+            last = w;
+        }
+
+        W* pop_front() {
+            W* w = first;
+            first = static_cast<W*>(w->next);
+            if (!first) last = nullptr;
+            return w;
+        }
+    };
+
+public:
+    class push_awaiter : public waiter {
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        // Returns false (do not suspend) when the push completes at once.
+        bool await_suspend(std::coroutine_handle<> h) {
+            async_buffer& q = *buffer_;
+            std::coroutine_handle<> wake;
+            {
+                std::lock_guard<std::mutex> guard(q.lock_);
+                if (q.closed_) {
+                    ok_ = false;
+                    return false;
+                }
+                if (!q.consumers_.empty()) {
+                    // Buffer is empty: hand the item straight over.
+                    pop_awaiter* consumer = q.consumers_.pop_front();
+                    consumer->item_ = std::move(item_);
+                    wake = consumer->handle;
+                } else if (q.items_.size() < q.capacity_) {
+                    q.items_.push_back(std::move(item_));
+                } else {
+                    this->handle = h;
+                    q.producers_.push_back(this);
+                    q.producer_waits_++;
+                    return true;
+                }
+            }
+            if (wake) q.resume(wake);
+            return false;
+        }
+
+        bool await_resume() const noexcept { return ok_; }
+
+    private:
+        friend class async_buffer;
+        push_awaiter(async_buffer* buffer, T item) : buffer_(buffer), item_(std::move(item)) {}
+
+        async_buffer* buffer_;
+        T item_;
+        bool ok_ = true;
+    };
+
+    class pop_awaiter : public waiter {
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        // Returns false (do not suspend) when the pop completes at once.
+        bool await_suspend(std::coroutine_handle<> h) {
+            async_buffer& q = *buffer_;
+            std::coroutine_handle<> wake;
+            {
+                std::lock_guard<std::mutex> guard(q.lock_);
+                if (!q.items_.empty()) {
+                    item_ = std::move(q.items_.front());
+                    q.items_.pop_front();
+                    if (!q.producers_.empty()) {
+                        // Buffer was full: take the oldest waiting item.
+                        push_awaiter* producer = q.producers_.pop_front();
+                        q.items_.push_back(std::move(producer->item_));
+                        wake = producer->handle;
+                    }
+                } else if (q.closed_) {
+                    return false;
+                } else {
+                    this->handle = h;
+                    q.consumers_.push_back(this);
+                    q.consumer_waits_++;
+                    return true;
+                }
+            }
+            if (wake) q.resume(wake);
+            return false;
+        }
+
+        std::optional<T> await_resume() noexcept { return std::move(item_); }
+
+    private:
+        friend class async_buffer;
+        explicit pop_awaiter(async_buffer* buffer) : buffer_(buffer) {}
+
+        async_buffer* buffer_;
+        std::optional<T> item_;
+    };
+
+    async_buffer(executor& pool, size_t capacity) : pool_(pool), capacity_(capacity ? capacity : 1) {}
+
+    async_buffer(const async_buffer&) = delete;
+    async_buffer& operator=(const async_buffer&) = delete;
+
+    push_awaiter push(T item) { return push_awaiter(this, std::move(item)); }
+
+    pop_awaiter pop() { return pop_awaiter(this); }
+
+    void close() {
+        waiter_list<push_awaiter> producers;
+        waiter_list<pop_awaiter> consumers;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            closed_ = true;
+            std::swap(producers, producers_);
+            std::swap(consumers, consumers_);
+        }
+        while (!producers.empty()) {
+            push_awaiter* producer = producers.pop_front();
+            producer->ok_ = false;
+            resume(producer->handle);
+        }
+        while (!consumers.empty()) resume(consumers.pop_front()->handle);
+    }
+
+    // Number of pushes and pops that had to suspend.
+    size_t producer_waits() {
+        std::lock_guard<std::mutex> guard(lock_);
+        return producer_waits_;
+    }
+
+    size_t consumer_waits() {
+        std::lock_guard<std::mutex> guard(lock_);
+        return consumer_waits_;
+    }
+
+private:
+    void resume(std::coroutine_handle<> h) {
+        pool_.post([h] { h.resume(); });
+    }
+
+    executor& pool_;
+    size_t capacity_;
+    std::mutex lock_;
+    std::deque<T> items_;
+    waiter_list<push_awaiter> producers_;   // Suspended pushes, buffer full
+    waiter_list<pop_awaiter> consumers_;    // Suspended pops, buffer empty
+    bool closed_ = false;
+    size_t producer_waits_ = 0;
+    size_t consumer_waits_ = 0;
+};
+
+#endif
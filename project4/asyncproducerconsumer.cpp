@@ -0,0 +1,126 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include "buffer.h"
+#include "async_buffer.h"
+
+//***********************************************************************
+//
+// Coroutine Producer/Consumer
+//
+// The producer/consumer simulation with coroutines in place of threads:
+// every producer and consumer is an async_task on a small executor, and
+// they meet in an async_buffer of BUFFER_SIZE slots. A task that finds
+// the buffer full or empty suspends rather than blocking, so the number
+// of producers and consumers is independent of the number of threads.
+//
+//***********************************************************************
+
+struct simulation {
+    async_buffer<buffer_item>& buffer;
+    std::atomic<int> producers_left{0};
+    std::atomic<int> consumers_left{0};
+    std::atomic<long> produced{0};
+    std::atomic<long> consumed{0};
+    std::atomic<long> primes{0};
+    std::promise<void> done{};
+};
+
+//***********************************************************************
+//
+// producer_task
+//
+// Push `items` random numbers from 1 to 100. The last producer to
+// finish closes the buffer, which lets the consumers drain it and stop.
+//
+//***********************************************************************
+async_task producer_task(simulation& sim, int items, unsigned int seed) {
+    long produced_count = 0;
+    for (int i = 0; i < items; i++) {
+        buffer_item num = rand_r(&seed) % 100 + 1;
+        if (!co_await sim.buffer.push(num)) break;
+        produced_count++;
+    }
+    sim.produced.fetch_add(produced_count, std::memory_order_relaxed);
+    if (sim.producers_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        sim.buffer.close();
+}
+
+//***********************************************************************
+//
+// consumer_task
+//
+// Pop items until the buffer is closed and empty, counting primes. The
+// last consumer to finish signals main.
+//
+//***********************************************************************
+async_task consumer_task(simulation& sim) {
+    long consumed_count = 0, prime_count = 0;
+    while (std::optional<buffer_item> item = co_await sim.buffer.pop()) {
+        consumed_count++;
+        if (is_prime(*item)) prime_count++;
+    }
+    sim.consumed.fetch_add(consumed_count, std::memory_order_relaxed);
+    sim.primes.fetch_add(prime_count, std::memory_order_relaxed);
+    if (sim.consumers_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        sim.done.set_value();
+}
+
+//***********************************************************************
+//
+// Main Function
+//
+// Parses the command line, spawns the producer and consumer tasks,
+// waits for the last consumer, then prints a report.
+//
+//***********************************************************************
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <num_producers> <num_consumers> <items_per_producer> [threads]" << std::endl;
+        std::cerr << "All four must be at least 1." << std::endl;
+        return 1;
+    }
+    int num_producers = atoi(argv[1]);
+    int num_consumers = atoi(argv[2]);
+    int items_per_producer = atoi(argv[3]);
+    int num_threads = argc > 4 ? atoi(argv[4]) : std::thread::hardware_concurrency();
+    if (num_producers < 1 || num_consumers < 1 || items_per_producer < 1 || num_threads < 1) {
+        std::cerr << "Producers, consumers, items per producer and threads must be at least 1." << std::endl;
+        return 1;
+    }
+
+    executor pool(num_threads);
+    async_buffer<buffer_item> buffer(pool, BUFFER_SIZE);
+    simulation sim{ buffer };
+    sim.producers_left = num_producers;
+    sim.consumers_left = num_consumers;
+    std::future<void> finished = sim.done.get_future();
+
+    auto start = std::chrono::steady_clock::now();
+    // Producers go first, so they fill the buffer and suspend on it
+    // before any consumer exists to resume them.
+    for (int i = 0; i < num_producers; i++)
+        spawn(pool, producer_task(sim, items_per_producer, i + 1));
+    for (int i = 0; i < num_consumers; i++)
+        spawn(pool, consumer_task(sim));
+    finished.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pool.shutdown();
+
+    // Display stats
+    std::cout << "COROUTINE PRODUCER / CONSUMER SIMULATION COMPLETE" << std::endl;
+    std::cout << "=================================================" << std::endl;
+    std::cout << "Number of Producer Tasks:                   " << num_producers << std::endl;
+    std::cout << "Number of Consumer Tasks:                   " << num_consumers << std::endl;
+    std::cout << "Number of Executor Threads:                 " << num_threads << std::endl;
+    std::cout << "Size of Buffer                              " << BUFFER_SIZE << std::endl << std::endl;
+    std::cout << "Total Number of Items Produced:             " << sim.produced << std::endl;
+    std::cout << "Total Number of Items Consumed:             " << sim.consumed << std::endl;
+    std::cout << "Number of Primes Consumed:                  " << sim.primes << std::endl;
+    std::cout << "Number of Times a Producer Waited           " << buffer.producer_waits() << std::endl;
+    std::cout << "Number of Times a Consumer Waited           " << buffer.consumer_waits() << std::endl;
+    std::cout << "Elapsed Seconds:                            " << seconds << std::endl;
+    std::cout << "Items per Second:                           " << (seconds > 0 ? sim.consumed / seconds : 0) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "buffer.h"
+
+// Global Variables
+sem_t empty, full;
+pthread_mutex_t mutex;
+buffer_item buffer[BUFFER_SIZE] = {-1,-1,-1,-1,-1};
+std::atomic<bool> simulation_running(true);
+int producer_index = 0;
+int consumer_index = 0;
+bool print_steps = false;
+
+void buffer_init() {
+    // Initialize semaphores and mutex.
+    sem_init(&empty, 0, BUFFER_SIZE);
+    sem_init(&full, 0, 0);
+    pthread_mutex_init(&mutex, NULL);
+}
+
+//***********************************************************************
+//
+// buffer_insert_item
+//
+// Insert `num` into the buffer at `producer_index` and advance
+// the index. This function does not perform synchronization itself and
+// must be called while holding the mutex.
+//
+//***********************************************************************
+void buffer_insert_item( buffer_item num )
+{
+    buffer[producer_index] = num;
+    if (print_steps == true)
+    {
+        std::cout << "Producer " << pthread_self() << " writes " << num << std::endl;
+    }
+    producer_index = (producer_index + 1) % BUFFER_SIZE;
+    return;
+}
+
+//***********************************************************************
+//
+// buffer_remove_item
+//
+// Logically remove the item at `consumer_index` by advancing the index.
+// This function prints the removed item when `print_steps` is true.
+//
+// Return Value
+// void                      no return value
+//
+//***********************************************************************
+void buffer_remove_item()
+{
+    if (print_steps == true)
+    {
+        std::cout << "Consumer " << pthread_self() << " reads " << buffer[consumer_index];
+        if (is_prime(buffer[consumer_index])) {
+            std::cout << "   * * * PRIME * * *";
+        }
+        std::cout << std::endl;
+    }
+    consumer_index = (consumer_index + 1) % BUFFER_SIZE;
+    return;
+}
+
+//***********************************************************************
+//
+// is_prime
+//
+// Check whether `num` is a prime number using a simple division
+// algorithm.
+//
+//***********************************************************************
+bool is_prime(int num) {
+    if (num <= 1) return false;
+    for (int i = 2; i <= num / 2; i++) {
+        if (num % i == 0) return false;
+    }
+    return true;
+}
+
+//***********************************************************************
+//
+// print_buffer
+//
+// Diagnostic helper that prints the current state of the
+// buffer. The function samples the `full` semaphore for a
+// quick count of occupied slots; this is only used for display and is
+// not relied on for synchronization correctness.
+//
+//***********************************************************************
+void print_buffer() {
+    int buffer_full_count;
+    sem_getvalue(&full, &buffer_full_count);
+    std::cout << "(Buffers Occupied: " << buffer_full_count << ")" << std::endl;
+    std::cout << "Buffers: ";
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        std::cout << buffer[i] << "   ";
+    }
+    std::cout << std::endl << "         ";
+    for (int i = 0; i <BUFFER_SIZE; i++) {
+        std::cout << "---  "; 
+    }
+    std::cout << std::endl << "         ";
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        if (i == producer_index && i == consumer_index) {
+            std::cout << "WR  ";
+        }
+        else if (i == producer_index) {
+            std::cout << " W   ";
+        }
+        else if (i == consumer_index) {
+            std::cout << " R   ";
+        }
+        else {
+            std::cout << "     ";
+        }
+    }
+    std::cout << std::endl << std::endl;
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _BUFFER_H_DEFINED_
 
 #include <pthread.h>
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -15,18 +16,14 @@ typedef int buffer_item;
 
 #define BUFFER_SIZE 5
 
-// Global Variables
-sem_t empty, full;
-pthread_mutex_t mutex;
-buffer_item buffer[BUFFER_SIZE] = {-1,-1,-1,-1,-1};
-bool simulation_running = true;
-int producer_index = 0;
-int consumer_index = 0;
-int buffer_empty_count = 0;
-int buffer_full_count = 0;
-int filled_buffer_count = 0;
-int empty_buffer_count = 0;
-bool print_steps = false;
+// Global Variables (defined in buffer.cpp)
+extern sem_t empty, full;
+extern pthread_mutex_t mutex;
+extern buffer_item buffer[BUFFER_SIZE];
+extern std::atomic<bool> simulation_running;
+extern int producer_index;
+extern int consumer_index;
+extern bool print_steps;
 
 
 void print_buffer();
@@ -35,9 +32,9 @@ void buffer_insert_item( buffer_item item );
 
 void buffer_remove_item();
 
-void* producer(void *args);
+int producer(int max_sleep_time);
 
-void *consumer(void* args);
+int consumer(int max_sleep_time);
 
 void buffer_init();
 
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "metrics.h"
+
+// Global Variables
+buffer_metrics metrics;
+
+// How often the reporters check whether the simulation has ended.
+#define METRICS_POLL_MS 200
+
+uint64_t metrics_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//***********************************************************************
+//
+// wait_histogram::quantile_seconds
+//
+// Estimate quantile `q` (0-1) as the upper bound of the bucket it falls
+// in, so the answer is within a factor of two. Returns 0 when nothing
+// has been recorded.
+//
+//***********************************************************************
+double wait_histogram::quantile_seconds(double q) const {
+    uint64_t total = 0;
+    uint64_t counts[WAIT_BUCKETS];
+    for (int k = 0; k < WAIT_BUCKETS; k++) {
+        counts[k] = buckets[k].load(std::memory_order_relaxed);
+        total += counts[k];
+    }
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int k = 0; k < WAIT_BUCKETS; k++) {
+        seen += counts[k];
+        if (seen >= rank) return (double)(1ull << k) / 1e9;
+    }
+    return (double)(1ull << (WAIT_BUCKETS - 1)) / 1e9;
+}
+
+static void append(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(std::string& out, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += line;
+}
+
+static void append_metric(std::string& out, const char* name, const char* type,
+                          const char* help, long long value) {
+    append(out, "# HELP %s %s\n# TYPE %s %s\n%s %lld\n", name, help, name, type, name, value);
+}
+
+static void append_histogram(std::string& out, const char* name, const char* help,
+                             const wait_histogram& h) {
+    append(out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t cumulative = 0;
+    for (int k = 0; k < WAIT_BUCKETS - 1; k++) {
+        cumulative += h.buckets[k].load(std::memory_order_relaxed);
+        append(out, "%s_bucket{le=\"%.9g\"} %llu\n", name, (double)(1ull << k) / 1e9,
+               (unsigned long long)cumulative);
+    }
+    cumulative += h.buckets[WAIT_BUCKETS - 1].load(std::memory_order_relaxed);
+    append(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+    append(out, "%s_sum %.9f\n%s_count %llu\n", name,
+           h.sum_ns.load(std::memory_order_relaxed) / 1e9, name, (unsigned long long)cumulative);
+}
+
+//***********************************************************************
+//
+// metrics_prometheus
+//
+// Render a snapshot of `metrics` in the Prometheus text exposition
+// format.
+//
+//***********************************************************************
+std::string metrics_prometheus() {
+    std::string out;
+    append_metric(out, "pc_items_produced_total", "counter", "Items inserted into the buffer.",
+                  metrics.produced.load(std::memory_order_relaxed));
+    append_metric(out, "pc_items_consumed_total", "counter", "Items removed from the buffer.",
+                  metrics.consumed.load(std::memory_order_relaxed));
+    append_metric(out, "pc_buffer_full_total", "counter", "Inserts that left the buffer full.",
+                  metrics.buffer_full_events.load(std::memory_order_relaxed));
+    append_metric(out, "pc_buffer_empty_total", "counter", "Removes that left the buffer empty.",
+                  metrics.buffer_empty_events.load(std::memory_order_relaxed));
+    append_metric(out, "pc_buffer_capacity", "gauge", "Number of slots in the buffer.", BUFFER_SIZE);
+    append_metric(out, "pc_buffer_occupancy", "gauge", "Items currently in the buffer.",
+                  metrics.occupancy.load(std::memory_order_relaxed));
+    append_metric(out, "pc_waiting_producers", "gauge", "Producers waiting for an empty slot.",
+                  metrics.waiting_producers.load(std::memory_order_relaxed));
+    append_metric(out, "pc_waiting_consumers", "gauge", "Consumers waiting for an item.",
+                  metrics.waiting_consumers.load(std::memory_order_relaxed));
+
+    out += "# HELP pc_buffer_occupancy_observed Buffer occupancy after each insert or remove.\n"
+           "# TYPE pc_buffer_occupancy_observed histogram\n";
+    uint64_t cumulative = 0, weighted = 0;
+    for (int i = 0; i <= BUFFER_SIZE; i++) {
+        uint64_t n = metrics.occupancy_samples[i].load(std::memory_order_relaxed);
+        cumulative += n;
+        weighted += n * i;
+        append(out, "pc_buffer_occupancy_observed_bucket{le=\"%d\"} %llu\n", i, (unsigned long long)cumulative);
+    }
+    append(out, "pc_buffer_occupancy_observed_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    append(out, "pc_buffer_occupancy_observed_sum %llu\npc_buffer_occupancy_observed_count %llu\n",
+           (unsigned long long)weighted, (unsigned long long)cumulative);
+
+    append_histogram(out, "pc_enqueue_wait_seconds", "Time producers waited for an empty slot.",
+                     metrics.enqueue_wait);
+    append_histogram(out, "pc_dequeue_wait_seconds", "Time consumers waited for an item.",
+                     metrics.dequeue_wait);
+    return out;
+}
+
+//***********************************************************************
+//
+// metrics_summary
+//
+// One-line human-readable snapshot: totals, current occupancy, waiting
+// threads and the median and 99th percentile wait on each side.
+//
+//***********************************************************************
+std::string metrics_summary() {
+    std::string out;
+    append(out, "[metrics] produced %llu consumed %llu occupancy %d/%d waiting p=%d c=%d "
+                "full %llu empty %llu enqueue_wait p50<=%.3gs p99<=%.3gs dequeue_wait p50<=%.3gs p99<=%.3gs\n",
+           (unsigned long long)metrics.produced.load(std::memory_order_relaxed),
+           (unsigned long long)metrics.consumed.load(std::memory_order_relaxed),
+           metrics.occupancy.load(std::memory_order_relaxed), BUFFER_SIZE,
+           metrics.waiting_producers.load(std::memory_order_relaxed),
+           metrics.waiting_consumers.load(std::memory_order_relaxed),
+           (unsigned long long)metrics.buffer_full_events.load(std::memory_order_relaxed),
+           (unsigned long long)metrics.buffer_empty_events.load(std::memory_order_relaxed),
+           metrics.enqueue_wait.quantile_seconds(0.5), metrics.enqueue_wait.quantile_seconds(0.99),
+           metrics.dequeue_wait.quantile_seconds(0.5), metrics.dequeue_wait.quantile_seconds(0.99));
+    return out;
+}
+
+//***********************************************************************
+//
+// metrics_print_every
+//
+// Write metrics_summary() to stderr every `seconds` seconds until the
+// simulation stops. Meant to run as its own task.
+//
+//***********************************************************************
+void metrics_print_every(int seconds) {
+    uint64_t interval = (uint64_t)seconds * 1000000000ull;
+    uint64_t next = metrics_now_ns() + interval;
+    while (simulation_running) {
+        if (metrics_now_ns() >= next) {
+            std::string line = metrics_summary();
+            fputs(line.c_str(), stderr);
+            next += interval;
+        }
+        usleep(METRICS_POLL_MS * 1000);
+    }
+}
+
+// Send all of `text` to a connected socket, ignoring a client that
+// hangs up early.
+static void send_all(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+// Remove the socket at `path`, if there is one. Anything else at that
+// path (e.g. a regular file named by a typo) is left alone and
+// reported. Returns true if the path is now free.
+static bool remove_socket(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) < 0) {
+        if (errno == ENOENT) return true;
+        perror(path.c_str());
+        return false;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        std::cerr << "metrics socket path exists and is not a socket: " << path << std::endl;
+        return false;
+    }
+    if (unlink(path.c_str()) < 0) {
+        perror(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Answer one connection. A client that sends an HTTP request (e.g.
+// `curl --unix-socket`) gets an HTTP response; anything else (e.g.
+// `nc -U`) gets the bare exposition text.
+static void serve_client(int client) {
+    char request[512];
+    ssize_t n = 0;
+    struct pollfd pfd = { client, POLLIN, 0 };
+    if (poll(&pfd, 1, METRICS_POLL_MS) > 0)
+        n = recv(client, request, sizeof(request), 0);
+    std::string body = metrics_prometheus();
+    if (n >= 4 && memcmp(request, "GET ", 4) == 0) {
+        send_all(client, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+    }
+    send_all(client, body);
+    close(client);
+}
+
+//***********************************************************************
+//
+// metrics_serve
+//
+// Listen on the Unix socket `socket_path` and answer every connection
+// with a Prometheus snapshot until the simulation stops, then remove
+// the socket. Returns false if the socket cannot be set up. Meant to run
+// as its own task.
+//
+//***********************************************************************
+bool metrics_serve(const std::string& socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "metrics socket path too long: " << socket_path << std::endl;
+        return false;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        perror("socket");
+        return false;
+    }
+    // Clear a socket left by an earlier run, but never anything else.
+    if (!remove_socket(socket_path)) {
+        close(server);
+        return false;
+    }
+    if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 8) < 0) {
+        perror(socket_path.c_str());
+        close(server);
+        return false;
+    }
+
+    while (simulation_running) {
+        struct pollfd pfd = { server, POLLIN, 0 };
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0) continue;
+        int client = accept(server, NULL, NULL);
+        if (client >= 0) serve_client(client);
+    }
+    close(server);
+    remove_socket(socket_path);
+    return true;
+}
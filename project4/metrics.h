@@ -0,0 +1,71 @@
+#ifndef _METRICS_H_DEFINED_
+#define _METRICS_H_DEFINED_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "buffer.h"
+
+// Number of log2 buckets in a wait-time histogram. Bucket k counts waits
+// of at most 2^k nanoseconds (and more than 2^(k-1)), so 2^k is an
+// inclusive upper bound like a Prometheus `le`; the last bucket also
+// takes everything longer, so it is the +Inf bucket.
+#define WAIT_BUCKETS 40
+
+//***********************************************************************
+//
+// wait_histogram
+//
+// Lock-free histogram of wait times. Recording is two relaxed atomic
+// adds and one more for the running sum, so it is cheap enough to sit on
+// every buffer operation. Readers see each bucket atomically, but a
+// snapshot taken while threads are recording may be a few samples off
+// between buckets, which is fine for monitoring.
+//
+//***********************************************************************
+struct wait_histogram {
+    std::atomic<uint64_t> buckets[WAIT_BUCKETS] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+
+    void record(uint64_t ns) {
+        int k = ns <= 1 ? 0 : 64 - __builtin_clzll(ns - 1);
+        if (k >= WAIT_BUCKETS) k = WAIT_BUCKETS - 1;
+        buckets[k].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    double quantile_seconds(double q) const;
+};
+
+// Counters, gauges and histograms for the shared buffer. Everything is
+// updated with relaxed atomics; `occupancy` changes only under the buffer
+// mutex, so it is exact, and the rest are monotonic counts or
+// best-effort gauges.
+struct buffer_metrics {
+    std::atomic<uint64_t> produced{0};
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<uint64_t> buffer_full_events{0};    // Insert left the buffer full
+    std::atomic<uint64_t> buffer_empty_events{0};   // Remove left the buffer empty
+    std::atomic<int> occupancy{0};                  // Items currently in the buffer
+    std::atomic<int> waiting_producers{0};          // Producers inside sem_wait(&empty)
+    std::atomic<int> waiting_consumers{0};          // Consumers inside sem_wait(&full)
+    std::atomic<uint64_t> occupancy_samples[BUFFER_SIZE + 1] = {};   // Occupancy after each operation
+    wait_histogram enqueue_wait;                    // Time spent waiting for an empty slot
+    wait_histogram dequeue_wait;                    // Time spent waiting for an item
+};
+
+extern buffer_metrics metrics;
+
+uint64_t metrics_now_ns();
+
+std::string metrics_prometheus();
+
+std::string metrics_summary();
+
+void metrics_print_every(int seconds);
+
+bool metrics_serve(const std::string& socket_path);
+
+#endif
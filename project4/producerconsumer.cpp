@@ -1,13 +1,17 @@
+#include <future>
 #include "buffer.h"
+#include "metrics.h"
+#include "../common/executor.h"
 
 //***********************************************************************
 //
 // Main Function
 //
 // Entry point for the producer/consumer simulation. Parses command-line
-// arguments, starts producer and consumer threads, runs the simulation
-// for the requested time, then signals shutdown and gathers per-thread
-// statistics before printing a final report.
+// arguments, runs the producers and consumers as tasks on a shared
+// executor, runs the simulation for the requested time, then signals
+// shutdown and gathers per-task statistics from their futures before
+// printing a final report.
 //
 //***********************************************************************
 
@@ -23,20 +27,42 @@ int main(int argc, char* argv[]) {
     if (std::string(argv[5]) == "yes")
          print_steps = true;
 
+    // Optional live metrics: a number prints a snapshot to stderr every
+    // that many seconds; "unix:PATH" serves Prometheus text on a socket.
+    std::string metrics_arg = argc > 6 ? argv[6] : "";
+    int metrics_interval = 0;
+    std::string metrics_socket;
+    if (metrics_arg.compare(0, 5, "unix:") == 0) {
+        metrics_socket = metrics_arg.substr(5);
+    } else if (!metrics_arg.empty()) {
+        metrics_interval = atoi(metrics_arg.c_str());
+        if (metrics_interval <= 0) {
+            std::cerr << "metrics must be an interval in seconds or unix:PATH" << std::endl;
+            return 1;
+        }
+    }
 
-    // Create producer and consumer threads
+    // Start producer and consumer tasks. Each one blocks on the buffer
+    // semaphores, so the pool gets one worker per task, plus one for the
+    // metrics reporter if there is one.
 
     std::cout << "Starting Threads" << std::endl;
     if (print_steps == true) print_buffer();
-    pthread_t producer_thread[num_producers], consumer_thread[num_consumers];
+    bool reporting = metrics_interval > 0 || !metrics_socket.empty();
+    executor pool(num_producers + num_consumers + (reporting ? 1 : 0));
+    if (metrics_interval > 0)
+        pool.post([metrics_interval] { metrics_print_every(metrics_interval); });
+    else if (!metrics_socket.empty())
+        pool.post([metrics_socket] { metrics_serve(metrics_socket); });
+    std::vector<std::future<int>> produced_counts, consumed_counts;
     for (int i = 0; i < num_producers; i++)
     {
-        pthread_create(&producer_thread[i], nullptr, producer, &max_sleep_time);
+        produced_counts.push_back(pool.submit([max_sleep_time] { return producer(max_sleep_time); }));
     }
 
     for (int i = 0; i < num_consumers; i++)
     {
-        pthread_create(&consumer_thread[i], nullptr, consumer, &max_sleep_time);
+        consumed_counts.push_back(pool.submit([max_sleep_time] { return consumer(max_sleep_time); }));
     }
 
     // Wait for both threads to finish
@@ -46,17 +72,17 @@ int main(int argc, char* argv[]) {
     for (int i = 0; i < num_producers; ++i) sem_post(&empty);
     for (int i = 0; i < num_consumers; ++i) sem_post(&full);
 
-    void* produced_counts[num_producers];
-    void* consumed_counts[num_consumers];
+    std::vector<int> produced(num_producers), consumed(num_consumers);
     for (int i = 0; i < num_producers; i++)
     {
-        pthread_join(producer_thread[i], &produced_counts[i]);
+        produced[i] = produced_counts[i].get();
     }
 
     for (int i = 0; i < num_consumers; i++)
     {
-        pthread_join(consumer_thread[i], &consumed_counts[i]);
+        consumed[i] = consumed_counts[i].get();
     }
+    pool.shutdown();
 
     // Clean up mutex and condition variables
     pthread_mutex_destroy(&mutex);
@@ -74,27 +100,26 @@ int main(int argc, char* argv[]) {
 
     int total_produced = 0;
     for (int i = 0; i < num_producers; i++) {
-        total_produced += *((int*)produced_counts[i]);
+        total_produced += produced[i];
     }
     std::cout << "Total Number of Items Produced: " << total_produced << std::endl;
     for (int i = 0; i < num_producers; i++) {
-        std::cout << "    Producer " << i+1 << ": " << *((int*)produced_counts[i]) << std::endl;
+        std::cout << "    Producer " << i+1 << ": " << produced[i] << std::endl;
     }
     std::cout << std::endl;
 
     int total_consumed = 0;
     for (int i = 0; i < num_consumers; i++) {
-        total_consumed += *((int*)consumed_counts[i]);
+        total_consumed += consumed[i];
     }
     std::cout << "Total Number of Items Consumed:  " << total_consumed << std::endl;
     for (int i = 0; i < num_consumers; i++) {
-        std::cout << "    Consumer " << i+1 << ": " << *((int*)consumed_counts[i]) << std::endl;
+        std::cout << "    Consumer " << i+1 << ": " << consumed[i] << std::endl;
     }
     std::cout << std::endl;
-    // sem_getvalue(&full, &buffer_full_count);
-    std::cout << "Number of Items Remaining in Buffer         " << buffer_full_count << std::endl;
-    std::cout << "Number of Times Buffer was Full             " << filled_buffer_count << std::endl;
-    std::cout << "Number of Times Buffer was Empty            " << empty_buffer_count << std::endl;
+    std::cout << "Number of Items Remaining in Buffer         " << metrics.occupancy << std::endl;
+    std::cout << "Number of Times Buffer was Full             " << metrics.buffer_full_events << std::endl;
+    std::cout << "Number of Times Buffer was Empty            " << metrics.buffer_empty_events << std::endl;
     std::cout << " " << std::endl;
 
     return 0;
@@ -104,38 +129,46 @@ int main(int argc, char* argv[]) {
 //
 // producer
 //
-// Producer thread function: repeatedly sleeps for a random interval
-// (bounded by `max_sleep_time`), generates a random item, waits for an
-// empty slot (`sem_wait(&empty)`), takes the mutex to update the shared
-// buffer via `buffer_insert_item`, and signals `full` when done.
+// Producer task: repeatedly sleeps for a random interval (bounded by
+// `max_sleep_time`), generates a random item, waits for an empty slot
+// (`sem_wait(&empty)`), takes the mutex to update the shared buffer via
+// `buffer_insert_item`, and signals `full` when done. Returns the number
+// of items produced.
 //
 //***********************************************************************
 
-void* producer(void *max_sleep_time) {
-    int *produced_count = new int(0);
+int producer(int max_sleep_time) {
+    int produced_count = 0;
     while (simulation_running) {
         unsigned int seed = pthread_self();
-        int rand = rand_r(&seed) % *static_cast<int*>(max_sleep_time) + 1;
+        int rand = rand_r(&seed) % max_sleep_time + 1;
         usleep(rand*1000000);
         buffer_item num = rand_r(&seed) % 100 + 1;
-        sem_getvalue(&empty, &buffer_empty_count);
-        if (buffer_empty_count == 0 && print_steps == true) {
+        if (print_steps == true && metrics.occupancy.load(std::memory_order_relaxed) == BUFFER_SIZE) {
             std::cout << "All buffers full. Producer " << pthread_self() << " waits" << std::endl;
         }
         // Block until an empty slot is available. This is where the
         // producer will wait if the buffer is full.
+        uint64_t wait_start = metrics_now_ns();
+        metrics.waiting_producers.fetch_add(1, std::memory_order_relaxed);
         sem_wait(&empty);
+        metrics.waiting_producers.fetch_sub(1, std::memory_order_relaxed);
+        metrics.enqueue_wait.record(metrics_now_ns() - wait_start);
+        // Woken by main at shutdown rather than by a consumer.
+        if (!simulation_running) break;
         pthread_mutex_lock(&mutex);
         buffer_insert_item(num);
-        (*produced_count)++;
+        produced_count++;
+        int occupied = metrics.occupancy.fetch_add(1, std::memory_order_relaxed) + 1;
         pthread_mutex_unlock(&mutex);
         // Signal that a new item is available to consumers.
         sem_post(&full);
-        // Update diagnostic counters after posting to reflect the
-        // new semaphore state; this is not used for synchronization. 
-        sem_getvalue(&full, &buffer_full_count);
-        if (buffer_full_count == BUFFER_SIZE) {
-            filled_buffer_count++;
+        // Update diagnostic counters; occupancy was read under the
+        // mutex, so it is exact. These are not used for synchronization.
+        metrics.produced.fetch_add(1, std::memory_order_relaxed);
+        metrics.occupancy_samples[occupied].fetch_add(1, std::memory_order_relaxed);
+        if (occupied == BUFFER_SIZE) {
+            metrics.buffer_full_events.fetch_add(1, std::memory_order_relaxed);
         }
         if (print_steps == true)
             print_buffer();
@@ -147,146 +180,45 @@ void* producer(void *max_sleep_time) {
 //
 // consumer
 //
-// Consumer thread function: sleeps for a random interval, waits for an
-// occupied slot, takes the mutex to remove an item
-// from the shared buffer via `buffer_remove_item`, and signals `empty`
-// when done.
+// Consumer task: sleeps for a random interval, waits for an occupied
+// slot, takes the mutex to remove an item from the shared buffer via
+// `buffer_remove_item`, and signals `empty` when done. Returns the
+// number of items consumed.
 //
 //***********************************************************************
 
-void* consumer(void *max_sleep_time) {
-    int *consumed_count = new int(0);
+int consumer(int max_sleep_time) {
+    int consumed_count = 0;
     while (simulation_running) {
         unsigned int seed = pthread_self();
-        int rand = rand_r(&seed) % *static_cast<int*>(max_sleep_time) + 1;
+        int rand = rand_r(&seed) % max_sleep_time + 1;
         usleep(rand*1000000);
-        sem_getvalue(&full, &buffer_full_count);
-        if (buffer_full_count == 0 && print_steps == true) {
+        if (print_steps == true && metrics.occupancy.load(std::memory_order_relaxed) == 0) {
             std::cout << "All buffers are empty. Consumer " << pthread_self() << " waits" << std::endl;
         }
         // Block until an item is available for consumption.
+        uint64_t wait_start = metrics_now_ns();
+        metrics.waiting_consumers.fetch_add(1, std::memory_order_relaxed);
         sem_wait(&full);
+        metrics.waiting_consumers.fetch_sub(1, std::memory_order_relaxed);
+        metrics.dequeue_wait.record(metrics_now_ns() - wait_start);
+        // Woken by main at shutdown rather than by a producer.
+        if (!simulation_running) break;
         pthread_mutex_lock(&mutex);
         buffer_remove_item();
-        (*consumed_count)++;
+        consumed_count++;
+        int occupied = metrics.occupancy.fetch_sub(1, std::memory_order_relaxed) - 1;
         pthread_mutex_unlock(&mutex);
         // Signal that a slot became empty after removing an item.
         sem_post(&empty);
-        // Update diagnostics and optionally print the buffer. 
-        sem_getvalue(&empty, &buffer_empty_count);
-        if (buffer_empty_count == BUFFER_SIZE) {
-            empty_buffer_count++;
+        // Update diagnostics and optionally print the buffer.
+        metrics.consumed.fetch_add(1, std::memory_order_relaxed);
+        metrics.occupancy_samples[occupied].fetch_add(1, std::memory_order_relaxed);
+        if (occupied == 0) {
+            metrics.buffer_empty_events.fetch_add(1, std::memory_order_relaxed);
         }
-        sem_getvalue(&full, &buffer_full_count);
         if (print_steps == true)
             print_buffer();
     }
     return consumed_count;
 }
-
-void buffer_init() {
-    // Initialize semaphores and mutex.
-    sem_init(&empty, 0, BUFFER_SIZE);
-    sem_init(&full, 0, 0);
-    pthread_mutex_init(&mutex, NULL);
-}
-
-//***********************************************************************
-//
-// buffer_insert_item
-//
-// Insert `num` into the buffer at `producer_index` and advance
-// the index. This function does not perform synchronization itself and
-// must be called while holding the mutex.
-//
-//***********************************************************************
-void buffer_insert_item( buffer_item num )
-{
-    buffer[producer_index] = num;
-    if (print_steps == true)
-    {
-        std::cout << "Producer " << pthread_self() << " writes " << num << std::endl;
-    }
-    producer_index = (producer_index + 1) % BUFFER_SIZE;
-    return;
-}
-
-//***********************************************************************
-//
-// buffer_remove_item
-//
-// Logically remove the item at `consumer_index` by advancing the index.
-// This function prints the removed item when `print_steps` is true.
-//
-// Return Value
-// void                      no return value
-//
-//***********************************************************************
-void buffer_remove_item()
-{
-    if (print_steps == true)
-    {
-        std::cout << "Consumer " << pthread_self() << " reads " << buffer[consumer_index];
-        if (is_prime(buffer[consumer_index])) {
-            std::cout << "   * * * PRIME * * *";
-        }
-        std::cout << std::endl;
-    }
-    consumer_index = (consumer_index + 1) % BUFFER_SIZE;
-    return;
-}
-
-//***********************************************************************
-//
-// is_prime
-//
-// Check whether `num` is a prime number using a simple division
-// algorithm.
-//
-//***********************************************************************
-bool is_prime(int num) {
-    if (num <= 1) return false;
-    for (int i = 2; i <= num / 2; i++) {
-        if (num % i == 0) return false;
-    }
-    return true;
-}
-
-//***********************************************************************
-//
-// print_buffer
-//
-// Diagnostic helper that prints the current state of the
-// buffer. The function samples the `full` semaphore for a
-// quick count of occupied slots; this is only used for display and is
-// not relied on for synchronization correctness.
-//
-//***********************************************************************
-void print_buffer() {
-    sem_getvalue(&full, &buffer_full_count);
-    std::cout << "(Buffers Occupied: " << buffer_full_count << ")" << std::endl;
-    std::cout << "Buffers: ";
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        std::cout << buffer[i] << "   ";
-    }
-    std::cout << std::endl << "         ";
-    for (int i = 0; i <BUFFER_SIZE; i++) {
-        std::cout << "---  "; 
-    }
-    std::cout << std::endl << "         ";
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        if (i == producer_index && i == consumer_index) {
-            std::cout << "WR  ";
-        }
-        else if (i == producer_index) {
-            std::cout << " W   ";
-        }
-        else if (i == consumer_index) {
-            std::cout << " R   ";
-        }
-        else {
-            std::cout << "     ";
-        }
-    }
-    std::cout << std::endl << std::endl;
-}
\ No newline at end of file
@@ -1,247 +1,191 @@
+#include <cstdlib>
 #include <iostream>
 #include <vector>
-#include <algorithm>
-#include <cmath>
 #include <random>
+#include <set>
 #include <string>
+#include "schedulers.h"
+#include "elevator.h"
 
 using namespace std;
 
-//***********************************************************************
-//
-// fcfs
-//
-// First-Come-First-Serve disk scheduling. Services requests in
-// the order they appear in the input list. Computes and returns the
-// total head movement 
-//
-//***********************************************************************
-int fcfs(vector<int>& cylinders, int head_pos)
-{
-    int total_movement = 0;
-    for (int cylinder : cylinders) {
-        total_movement += abs(cylinder - head_pos);
-        head_pos = cylinder;
-    }
-    return total_movement;
-}
-
-//***********************************************************************
-//
-// sstf
-//
-// Shortest-Seek-Time-First scheduling. At each step choose the
-// unvisited request closest to the current head position. This is a
-// greedy algorithm that minimizes immediate seek distance.
-//
-//***********************************************************************
-int sstf(vector<int> cylinders, int head_pos, int disk_size = 3000)
-{
-    int total_movement = 0;
-    vector<bool> visited(cylinders.size(), false);
+// Requests pending at once in --stream mode
+#define STREAM_DEPTH 64
 
-    for (size_t i = 0; i < cylinders.size(); ++i) {
-        int closest_index = -1;
-        int min_distance = disk_size;
+// Random request lists tried by the request_set and elevator checks
+#define CHECK_LISTS 300
+#define CHECK_ELEVATOR_LISTS 2000
 
-        // Find closest unvisited request
-        for (size_t j = 0; j < cylinders.size(); ++j) {
-            if (!visited[j]) {
-                int distance = abs(cylinders[j] - head_pos);
-                if (distance < min_distance) {
-                    min_distance = distance;
-                    closest_index = j;
-                }
-            }
+// Run `cylinders` through a streaming elevator, keeping `depth` requests
+// queued: each completion admits the next request. Returns the total
+// head movement.
+uint64_t stream_requests(const vector<int>& cylinders, int disk_size, int head_pos,
+                         bool circular, size_t depth)
+{
+    elevator engine(disk_size, head_pos, circular);
+    size_t admitted = 0;
+    while (admitted < cylinders.size() && admitted < depth) {
+        engine.insert(cylinders[admitted], admitted);
+        admitted++;
+    }
+    completion done;
+    while (engine.next(done)) {
+        if (admitted < cylinders.size()) {
+            engine.insert(cylinders[admitted], admitted);
+            admitted++;
         }
-
-        // Mark it served and accumulate movement
-        visited[closest_index] = true;
-        total_movement += abs(cylinders[closest_index] - head_pos);
-        head_pos = cylinders[closest_index];
     }
-
-    return total_movement;
+    return engine.total_movement();
 }
 
-//***********************************************************************
-//
-// scan
-//
-// SCAN algorithm: the head moves in one direction to the
-// end of the disk servicing requests along the way, then reverses and
-// services requests in the opposite direction. This implementation
-// assumes the head initially moves to the right (increasing
-// cylinder numbers).
-//
-//***********************************************************************
-int scan(vector<int> cylinders, int head_pos, int disk_size = 3000)
+// Random list of up to `max_requests` requests on a disk of `disk_size`
+// cylinders. Small disks make duplicates and requests at the head common.
+vector<int> random_requests(mt19937& gen, int disk_size, int max_requests)
 {
-    int total_movement = 0;
-    vector<int> left, right;
-
-    // Add the physical edges so the head goes to the end before
-    // reversing (this models the head touching the disk boundary).
-    right.push_back(disk_size - 1);
-    left.push_back(0);
-
-    // Partition requests relative to head position
-    for (int c : cylinders) {
-        if (c < head_pos)
-            left.push_back(c);
-        else
-            right.push_back(c);
-    }
-
-    // Sort so we service in order along each direction
-    sort(left.begin(), left.end(), greater<>());
-    sort(right.begin(), right.end());
-
-    // Move right first (increasing cylinder numbers)
-    for (int c : right) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
-    }
-    // Then reverse direction and service left side
-    for (int c : left) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
-    }
-    return total_movement;
+    vector<int> cylinders(uniform_int_distribution<>(1, max_requests)(gen));
+    uniform_int_distribution<> dist(0, disk_size - 1);
+    for (int& x : cylinders)
+        x = dist(gen);
+    return cylinders;
 }
 
 //***********************************************************************
 //
-// cscan
+// check_request_set
 //
-// CSCAN algorithm: the head moves in one direction to
-// the end of the disk servicing requests, then jumps back to the
-// beginning without servicing requests on the return trip . This implementation
-// models the jump by adding the distance from the current head to the
-// beginning.
+// Compares every request_set total with the batch function of the same
+// name, for every head position on CHECK_LISTS random lists. Returns
+// the number of mismatches, each reported on stderr.
 //
 //***********************************************************************
-int cscan(vector<int> cylinders, int head_pos, int disk_size = 3000)
+int check_request_set(mt19937& gen)
 {
-    int total_movement = 0;
-    vector<int> left, right;
-
-    // Add the physical edges for correctness when moving to the end
-    right.push_back(disk_size - 1);
-    left.push_back(0);
-
-    for (int c : cylinders) {
-        if (c < head_pos)
-            left.push_back(c);
-        else
-            right.push_back(c);
-    }
-
-    sort(left.begin(), left.end());
-    sort(right.begin(), right.end());
-
-    // Service requests to the right first (toward disk_size-1)
-    for (int c : right) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
-    }
-
-    // Jump to beginning. The cost of the jump is from the
-    // current head position back to cylinder 0.
-    total_movement += head_pos;
-    head_pos = 0;
-
-    // Then service requests that were on the left side in order
-    for (int c : left) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
+    int failures = 0;
+    for (int list = 0; list < CHECK_LISTS; list++) {
+        int disk_size = uniform_int_distribution<>(1, 400)(gen);
+        vector<int> cylinders = random_requests(gen, disk_size, 64);
+        request_set requests(cylinders, disk_size);
+        for (int head = 0; head < disk_size; head++) {
+            int expected[4] = { scan(cylinders, head, disk_size), cscan(cylinders, head, disk_size),
+                                look(cylinders, head), clook(cylinders, head) };
+            int actual[4] = { requests.scan(head), requests.cscan(head),
+                              requests.look(head), requests.clook(head) };
+            static const char* names[4] = { "scan", "cscan", "look", "clook" };
+            for (int i = 0; i < 4; i++) {
+                if (actual[i] != expected[i]) {
+                    cerr << "request_set::" << names[i] << ": list " << list << ", head " << head
+                         << ": " << actual[i] << " != " << expected[i] << "\n";
+                    failures++;
+                }
+            }
+        }
     }
-    return total_movement;
+    return failures;
 }
 
 //***********************************************************************
 //
-// look
+// check_elevator
 //
-// LOOK algorithm: similar to SCAN but the head only goes as far as the
-// furthest request in each direction.
+// Runs CHECK_ELEVATOR_LISTS random lists through the streaming LOOK and
+// C-LOOK engines. With every request inserted before the first next,
+// the total must match look() or clook(). With requests arriving between
+// completions, every request must still complete exactly once. In both
+// cases each completion's seek must be the distance from the previous
+// cylinder, and the seeks must add up to total_movement. Returns the
+// number of failed lists, each reported on stderr.
 //
 //***********************************************************************
-int look(vector<int> cylinders, int head_pos)
+int check_elevator(mt19937& gen)
 {
-    int total_movement = 0;
-    vector<int> left, right;
-
-    // Partition requests relative to head position
-    for (int c : cylinders) {
-        if (c < head_pos)
-            left.push_back(c);
-        else
-            right.push_back(c);
-    }
-
-    // Service to the right first, then to the left; do not include
-    // disk edges because LOOK stops at the last request.
-    sort(left.begin(), left.end(), greater<>());
-    sort(right.begin(), right.end());
-
-    for (int c : right) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
-    }
-
-    for (int c : left) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
+    int failures = 0;
+    for (int list = 0; list < CHECK_ELEVATOR_LISTS; list++) {
+        int disk_size = uniform_int_distribution<>(1, 5000)(gen);
+        int head = uniform_int_distribution<>(0, disk_size - 1)(gen);
+        vector<int> cylinders = random_requests(gen, disk_size, 200);
+        for (int mode = 0; mode < 4; mode++) {
+            bool circular = mode & 1;
+            bool streaming = mode & 2;
+            elevator engine(disk_size, head, circular);
+            size_t admitted = 0;
+            size_t depth = streaming ? uniform_int_distribution<size_t>(1, 16)(gen) : cylinders.size();
+            for (; admitted < cylinders.size() && admitted < depth; admitted++)
+                engine.insert(cylinders[admitted], admitted);
+            vector<int> completed(cylinders.size(), 0);
+            uint64_t seeks = 0;
+            int position = head;
+            bool ok = true;
+            completion done;
+            while (engine.next(done)) {
+                ok = ok && done.id < cylinders.size() && cylinders[done.id] == done.cylinder &&
+                     done.seek == abs(done.cylinder - position);
+                if (done.id < cylinders.size()) completed[done.id]++;
+                seeks += done.seek;
+                position = done.cylinder;
+                if (admitted < cylinders.size()) {
+                    engine.insert(cylinders[admitted], admitted);
+                    admitted++;
+                }
+            }
+            for (int count : completed)
+                ok = ok && count == 1;
+            ok = ok && seeks == engine.total_movement();
+            if (!streaming) {
+                int expected = circular ? clook(cylinders, head) : look(cylinders, head);
+                ok = ok && engine.total_movement() == (uint64_t)expected;
+            }
+            if (!ok) {
+                cerr << "elevator: list " << list << ", " << (circular ? "C-LOOK" : "LOOK")
+                     << (streaming ? ", streaming" : "") << ": completions or total differ\n";
+                failures++;
+            }
+        }
     }
-
-    return total_movement;
+    return failures;
 }
 
 //***********************************************************************
 //
-// clook
+// check_bitmap
 //
-// C-LOOK algorithm: The head moves in one direction
-// servicing requests up to the furthest request, then jumps to the
-// smallest request without traversing the unused track area.
+// Applies random sets and clears to cylinder_bitmaps of one, two and
+// three levels and a std::set side by side, comparing find_next and
+// find_prev at random positions, including ones off either end of the
+// disk. Returns the number of mismatches, each reported on stderr.
 //
 //***********************************************************************
-int clook(vector<int> cylinders, int head_pos)
+int check_bitmap(mt19937& gen)
 {
-    int total_movement = 0;
-    vector<int> left, right;
-
-    for (int c : cylinders) {
-        if (c < head_pos)
-            left.push_back(c);
-        else
-            right.push_back(c);
-    }
-
-    sort(left.begin(), left.end());
-    sort(right.begin(), right.end());
-
-    // Service to the right first
-    for (int c : right) {
-        total_movement += abs(c - head_pos);
-        head_pos = c;
-    }
-
-    if (!left.empty()) {
-        // Jump from the last serviced right request to the first left
-        // request; this models the circular jump but does not include
-        // outer disk edges.
-        total_movement += abs(right.back() - left.front());
-        head_pos = left.front();
-
-        for (int c : left) {
-            total_movement += abs(c - head_pos);
-            head_pos = c;
+    int failures = 0;
+    for (int size : { 1, 63, 64, 65, 4095, 4096, 4097, 100000, 262144, 262145 }) {
+        cylinder_bitmap bitmap(size);
+        set<int> reference;
+        uniform_int_distribution<> pos(0, size - 1);
+        uniform_int_distribution<> probe(-2, size + 1);
+        for (int op = 0; op < 20000 && failures < 10; op++) {
+            // Mostly sets at first, then mostly clears, so the bitmap
+            // passes through sparse, dense and empty states.
+            int p = pos(gen);
+            if ((int)(gen() % 20000) >= op) {
+                bitmap.set(p);
+                reference.insert(p);
+            } else {
+                bitmap.clear(p);
+                reference.erase(p);
+            }
+            int q = probe(gen);
+            auto after = reference.lower_bound(q);
+            int next = after == reference.end() ? -1 : *after;
+            auto before = reference.upper_bound(q);
+            int prev = before == reference.begin() ? -1 : *--before;
+            if (bitmap.find_next(q) != next || bitmap.find_prev(q) != prev) {
+                cerr << "cylinder_bitmap(" << size << "): at " << q << ": next " << bitmap.find_next(q)
+                     << " != " << next << " or prev " << bitmap.find_prev(q) << " != " << prev << "\n";
+                failures++;
+            }
         }
     }
-
-    return total_movement;
+    return failures;
 }
 
 //***********************************************************************
@@ -251,7 +195,8 @@ int clook(vector<int> cylinders, int head_pos)
 // Entry point for the disk scheduler simulator.
 //
 // This program expects a single command-line argument:
-//   argv[1] - starting head position (integer cylinder number)
+//   argv[1] - starting head position (integer cylinder number), or
+//             --sweep, --check, or --stream followed by the starting head
 //
 //  - Generates a random list of cylinder requests (default 3000
 //    requests in the range [0, disk_size-1]).
@@ -260,16 +205,41 @@ int clook(vector<int> cylinders, int head_pos)
 //    the specified starting head position.
 //  - Prints the total head movement for
 //    each algorithm. 
+//  - With --sweep, instead prints a CSV of the SCAN, CSCAN, LOOK and
+//    CLOOK totals for every starting head position, answered from one
+//    request_set.
+//  - With --stream, feeds the requests to the streaming LOOK and
+//    C-LOOK engines so that they arrive while the head is moving,
+//    with STREAM_DEPTH requests pending at any time.
+//  - With --check, compares the fast structures with the batch
+//    functions on fixed-seed random lists and exits 1 on any mismatch.
 //
 //***********************************************************************
 int main(int argc, char* argv[])
 {
     if (argc < 2) {
-        cerr << "Must provide starting head position as argument.\n";
+        cerr << "Must provide starting head position, --sweep, --stream <head> or --check as argument.\n";
         return 1;
     }
 
-    int starting_head = stoi(argv[1]);
+    if (string(argv[1]) == "--check") {
+        mt19937 gen(12345);
+        int request_set_failures = check_request_set(gen);
+        cout << "request_set vs batch SCAN/CSCAN/LOOK/CLOOK: " << (request_set_failures ? "FAILED" : "ok") << "\n";
+        int bitmap_failures = check_bitmap(gen);
+        cout << "cylinder_bitmap vs std::set:                " << (bitmap_failures ? "FAILED" : "ok") << "\n";
+        int elevator_failures = check_elevator(gen);
+        cout << "elevator vs batch LOOK/CLOOK:               " << (elevator_failures ? "FAILED" : "ok") << "\n";
+        return request_set_failures || elevator_failures || bitmap_failures ? 1 : 0;
+    }
+
+    bool sweep = string(argv[1]) == "--sweep";
+    bool stream = string(argv[1]) == "--stream";
+    if (stream && argc < 3) {
+        cerr << "--stream needs a starting head position.\n";
+        return 1;
+    }
+    int starting_head = sweep ? 0 : stoi(argv[stream ? 2 : 1]);
     const int size = 3000;
     vector<int> cylinders(size);
 
@@ -280,8 +250,25 @@ int main(int argc, char* argv[])
     for (int& x : cylinders)
         x = dist(gen);
 
+    if (sweep) {
+        request_set requests(cylinders, size);
+        cout << "head,scan,cscan,look,clook\n";
+        for (int head = 0; head < size; head++) {
+            cout << head << ',' << requests.scan(head) << ',' << requests.cscan(head) << ','
+                 << requests.look(head) << ',' << requests.clook(head) << '\n';
+        }
+        return 0;
+    }
+
     cout << "Starting head position: " << starting_head << "\n\n";
 
+    if (stream) {
+        cout << "Requests arrive while servicing, " << STREAM_DEPTH << " pending at a time\n";
+        cout << "LOOK total movement:  " << stream_requests(cylinders, size, starting_head, false, STREAM_DEPTH) << "\n";
+        cout << "CLOOK total movement: " << stream_requests(cylinders, size, starting_head, true, STREAM_DEPTH) << "\n";
+        return 0;
+    }
+
     cout << "FCFS total movement:  " << fcfs(cylinders, starting_head) << "\n";
     cout << "SSTF total movement:  " << sstf(cylinders, starting_head) << "\n";
     cout << "SCAN total movement:  " << scan(cylinders, starting_head) << "\n";
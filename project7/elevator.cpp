@@ -0,0 +1,221 @@
+#include <cstdlib>
+#include "elevator.h"
+
+using namespace std;
+
+//***********************************************************************
+//
+// cylinder_bitmap
+//
+//***********************************************************************
+cylinder_bitmap::cylinder_bitmap(int size) : size_(size)
+{
+    size_t bits = size > 0 ? size : 1;
+    do {
+        size_t words = (bits + 63) / 64;
+        levels_.push_back(vector<uint64_t>(words, 0));
+        bits = words;
+    } while (bits > 1);
+}
+
+void cylinder_bitmap::set(int pos)
+{
+    size_t i = pos;
+    for (auto& level : levels_) {
+        uint64_t& word = level[i >> 6];
+        bool was_empty = word == 0;
+        word |= 1ull << (i & 63);
+        if (!was_empty) return;
+        i >>= 6;
+    }
+}
+
+void cylinder_bitmap::clear(int pos)
+{
+    size_t i = pos;
+    for (auto& level : levels_) {
+        uint64_t& word = level[i >> 6];
+        word &= ~(1ull << (i & 63));
+        if (word != 0) return;
+        i >>= 6;
+    }
+}
+
+//***********************************************************************
+//
+// cylinder_bitmap::find_next
+//
+// Climb until some level has a set bit at or after the position (each
+// level up, the position becomes the index of the next word below),
+// then descend through the lowest set bit of each word.
+//
+//***********************************************************************
+int cylinder_bitmap::find_next(int pos) const
+{
+    if (pos < 0) pos = 0;
+    if (pos >= size_) return -1;
+    size_t i = pos;
+    size_t level = 0;
+    while (true) {
+        if (level == levels_.size()) return -1;
+        size_t w = i >> 6;
+        if (w >= levels_[level].size()) return -1;
+        uint64_t bits = levels_[level][w] & (~0ull << (i & 63));
+        if (bits) {
+            i = (w << 6) + __builtin_ctzll(bits);
+            break;
+        }
+        i = w + 1;
+        level++;
+    }
+    while (level > 0) {
+        level--;
+        i = (i << 6) + __builtin_ctzll(levels_[level][i]);
+    }
+    return (int)i;
+}
+
+//***********************************************************************
+//
+// cylinder_bitmap::find_prev
+//
+// Mirror image of find_next: look for a set bit at or before the
+// position, climbing to the previous word's summary bit when a word has
+// none, then descend through the highest set bit of each word.
+//
+//***********************************************************************
+int cylinder_bitmap::find_prev(int pos) const
+{
+    if (pos < 0) return -1;
+    if (pos >= size_) pos = size_ - 1;
+    size_t i = pos;
+    size_t level = 0;
+    while (true) {
+        if (level == levels_.size()) return -1;
+        size_t w = i >> 6;
+        uint64_t mask = (i & 63) == 63 ? ~0ull : (2ull << (i & 63)) - 1;
+        uint64_t bits = levels_[level][w] & mask;
+        if (bits) {
+            i = (w << 6) + 63 - __builtin_clzll(bits);
+            break;
+        }
+        if (w == 0) return -1;
+        i = w - 1;
+        level++;
+    }
+    while (level > 0) {
+        level--;
+        i = (i << 6) + 63 - __builtin_clzll(levels_[level][i]);
+    }
+    return (int)i;
+}
+
+//***********************************************************************
+//
+// elevator
+//
+//***********************************************************************
+elevator::elevator(int disk_size, int head_pos, bool circular)
+    : queued_(disk_size), waiting_(disk_size > 0 ? disk_size : 0, fifo{ NIL, NIL }),
+      disk_size_(disk_size), head_(head_pos), circular_(circular)
+{
+}
+
+bool elevator::insert(int cylinder, uint64_t id)
+{
+    if (cylinder < 0 || cylinder >= disk_size_) return false;
+
+    uint32_t n;
+    if (free_ != NIL) {
+        n = free_;
+        free_ = nodes_[n].next;
+    } else {
+        n = nodes_.size();
+        nodes_.push_back(node());
+    }
+    nodes_[n].id = id;
+    nodes_[n].next = NIL;
+
+    fifo& queue = waiting_[cylinder];
+    if (queue.first == NIL) {
+        queue.first = n;
+        queue.last = n;
+        queued_.set(cylinder);
+    } else {
+        nodes_[queue.last].next = n;
+        queue.last = n;
+    }
+    pending_++;
+    return true;
+}
+
+//***********************************************************************
+//
+// pick_cylinder
+//
+// Next cylinder to visit, with at least one cylinder queued. Continue
+// in the current direction past the head; at the end, LOOK reverses and
+// C-LOOK jumps to the lowest queued cylinder. The head's own cylinder is
+// only taken before the first pick or when nothing else is queued.
+//
+//***********************************************************************
+int elevator::pick_cylinder()
+{
+    int from = started_ ? 1 : 0;
+    int c;
+    if (up_) {
+        c = queued_.find_next(head_ + from);
+        if (c >= 0) return c;
+        if (circular_) return queued_.find_next(0);
+        c = queued_.find_prev(head_ - 1);
+        if (c >= 0) {
+            up_ = false;
+            return c;
+        }
+    } else {
+        c = queued_.find_prev(head_ - from);
+        if (c >= 0) return c;
+        c = queued_.find_next(head_ + 1);
+        if (c >= 0) {
+            up_ = true;
+            return c;
+        }
+    }
+    return head_;
+}
+
+//***********************************************************************
+//
+// next
+//
+// When the current batch is used up, move the head to the next queued
+// cylinder and take its whole FIFO as the new batch. Then hand out the
+// oldest request of the batch; only the first of a batch has a seek.
+//
+//***********************************************************************
+bool elevator::next(completion& out)
+{
+    if (pending_ == 0) return false;
+
+    int seek = 0;
+    if (batch_.first == NIL) {
+        int c = pick_cylinder();
+        batch_ = waiting_[c];
+        waiting_[c] = fifo{ NIL, NIL };
+        queued_.clear(c);
+        seek = abs(c - head_);
+        total_movement_ += seek;
+        head_ = c;
+        started_ = true;
+    }
+
+    uint32_t n = batch_.first;
+    batch_.first = nodes_[n].next;
+    out.id = nodes_[n].id;
+    out.cylinder = head_;
+    out.seek = seek;
+    nodes_[n].next = free_;
+    free_ = n;
+    pending_--;
+    return true;
+}
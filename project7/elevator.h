@@ -0,0 +1,116 @@
+#ifndef _ELEVATOR_H_DEFINED_
+#define _ELEVATOR_H_DEFINED_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//***********************************************************************
+//
+// cylinder_bitmap
+//
+// Hierarchical bitmap over cylinders. Level 0 has one bit per cylinder;
+// each level above has one bit per non-zero word of the level below,
+// up to a single top word. Setting or clearing a bit touches one word
+// per level, and finding the next or previous set bit from any position
+// takes one count-zeros instruction per level, so both are O(log64 n):
+// two levels up to 4096 cylinders, three up to 262144.
+//
+//***********************************************************************
+class cylinder_bitmap {
+public:
+    explicit cylinder_bitmap(int size);
+
+    void set(int pos);
+
+    void clear(int pos);
+
+    // Smallest set position >= pos, or -1 if there is none.
+    int find_next(int pos) const;
+
+    // Largest set position <= pos, or -1 if there is none.
+    int find_prev(int pos) const;
+
+private:
+    std::vector<std::vector<uint64_t>> levels_;
+    int size_;
+};
+
+// One serviced request, as emitted by elevator::next.
+struct completion {
+    uint64_t id;       // Caller's id from elevator::insert
+    int cylinder;
+    int seek;          // Head movement to reach it from the previous one
+};
+
+//***********************************************************************
+//
+// elevator
+//
+// Stateful LOOK (or, if `circular`, C-LOOK) scheduler that accepts
+// requests while it is sweeping. Pending cylinders are bits in a
+// cylinder_bitmap; requests for the same cylinder wait in a FIFO kept
+// as an intrusive list in a node pool, so insert and next are O(1) apart
+// from the O(log64 n) bitmap search, and allocate nothing once the pool
+// has grown to the peak queue depth.
+//
+// On arriving at a cylinder, next takes every request queued there as
+// one batch. Requests for that cylinder that arrive afterwards wait for
+// the next pass, so a stream of requests at the head cannot starve the
+// rest of the disk.
+//
+// With every request inserted before the first next, the completions
+// and total movement match look() (or clook()) for the same list and
+// head. Not thread-safe; callers serialize, as a block layer does under
+// its queue lock.
+//
+//***********************************************************************
+class elevator {
+public:
+    elevator(int disk_size, int head_pos = 0, bool circular = false);
+
+    // Queue request `id` for `cylinder`. Returns false if `cylinder` is
+    // not on the disk.
+    bool insert(int cylinder, uint64_t id);
+
+    // Service the next request and store it in `out`. Returns false if
+    // nothing is pending.
+    bool next(completion& out);
+
+    size_t pending() const { return pending_; }
+
+    int head() const { return head_; }
+
+    uint64_t total_movement() const { return total_movement_; }
+
+private:
+    struct node {
+        uint64_t id;
+        uint32_t next;
+    };
+
+    // Head and tail of a FIFO in `nodes_`, NIL when empty.
+    struct fifo {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    static const uint32_t NIL = UINT32_MAX;
+
+    int pick_cylinder();
+
+    cylinder_bitmap queued_;       // Cylinders with requests waiting for a pass
+    std::vector<fifo> waiting_;    // Per-cylinder FIFO of those requests
+    std::vector<node> nodes_;
+    uint32_t free_ = NIL;          // Free list through node::next
+    fifo batch_ = { NIL, NIL };    // Requests being serviced at the head
+    int disk_size_;
+    int head_;
+    bool up_ = true;               // Current sweep direction
+    bool circular_;
+    bool started_ = false;         // The head cylinder is eligible until the first pick
+    size_t pending_ = 0;
+    uint64_t total_movement_ = 0;
+};
+
+#endif
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cstdlib>
+#include "schedulers.h"
+
+using namespace std;
+
+//***********************************************************************
+//
+// fcfs
+//
+// First-Come-First-Serve disk scheduling. Services requests in
+// the order they appear in the input list. Computes and returns the
+// total head movement 
+//
+//***********************************************************************
+int fcfs(vector<int>& cylinders, int head_pos)
+{
+    int total_movement = 0;
+    for (int cylinder : cylinders) {
+        total_movement += abs(cylinder - head_pos);
+        head_pos = cylinder;
+    }
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// sstf
+//
+// Shortest-Seek-Time-First scheduling. At each step choose the
+// unvisited request closest to the current head position. This is a
+// greedy algorithm that minimizes immediate seek distance.
+//
+//***********************************************************************
+int sstf(vector<int> cylinders, int head_pos, int disk_size)
+{
+    int total_movement = 0;
+    vector<bool> visited(cylinders.size(), false);
+
+    for (size_t i = 0; i < cylinders.size(); ++i) {
+        int closest_index = -1;
+        int min_distance = disk_size;
+
+        // Find closest unvisited request
+        for (size_t j = 0; j < cylinders.size(); ++j) {
+            if (!visited[j]) {
+                int distance = abs(cylinders[j] - head_pos);
+                if (distance < min_distance) {
+                    min_distance = distance;
+                    closest_index = j;
+                }
+            }
+        }
+
+        // Mark it served and accumulate movement
+        visited[closest_index] = true;
+        total_movement += abs(cylinders[closest_index] - head_pos);
+        head_pos = cylinders[closest_index];
+    }
+
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// scan
+//
+// SCAN algorithm: the head moves in one direction to the
+// end of the disk servicing requests along the way, then reverses and
+// services requests in the opposite direction. This implementation
+// assumes the head initially moves to the right (increasing
+// cylinder numbers).
+//
+//***********************************************************************
+int scan(vector<int> cylinders, int head_pos, int disk_size)
+{
+    int total_movement = 0;
+    vector<int> left, right;
+
+    // Add the physical edges so the head goes to the end before
+    // reversing (this models the head touching the disk boundary).
+    right.push_back(disk_size - 1);
+    left.push_back(0);
+
+    // Partition requests relative to head position
+    for (int c : cylinders) {
+        if (c < head_pos)
+            left.push_back(c);
+        else
+            right.push_back(c);
+    }
+
+    // Sort so we service in order along each direction
+    sort(left.begin(), left.end(), greater<>());
+    sort(right.begin(), right.end());
+
+    // Move right first (increasing cylinder numbers)
+    for (int c : right) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+    // Then reverse direction and service left side
+    for (int c : left) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// cscan
+//
+// CSCAN algorithm: the head moves in one direction to
+// the end of the disk servicing requests, then jumps back to the
+// beginning without servicing requests on the return trip . This implementation
+// models the jump by adding the distance from the current head to the
+// beginning.
+//
+//***********************************************************************
+int cscan(vector<int> cylinders, int head_pos, int disk_size)
+{
+    int total_movement = 0;
+    vector<int> left, right;
+
+    // Add the physical edges for correctness when moving to the end
+    right.push_back(disk_size - 1);
+    left.push_back(0);
+
+    for (int c : cylinders) {
+        if (c < head_pos)
+            left.push_back(c);
+        else
+            right.push_back(c);
+    }
+
+    sort(left.begin(), left.end());
+    sort(right.begin(), right.end());
+
+    // Service requests to the right first (toward disk_size-1)
+    for (int c : right) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+
+    // Jump to beginning. The cost of the jump is from the
+    // current head position back to cylinder 0.
+    total_movement += head_pos;
+    head_pos = 0;
+
+    // Then service requests that were on the left side in order
+    for (int c : left) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// look
+//
+// LOOK algorithm: similar to SCAN but the head only goes as far as the
+// furthest request in each direction.
+//
+//***********************************************************************
+int look(vector<int> cylinders, int head_pos)
+{
+    int total_movement = 0;
+    vector<int> left, right;
+
+    // Partition requests relative to head position
+    for (int c : cylinders) {
+        if (c < head_pos)
+            left.push_back(c);
+        else
+            right.push_back(c);
+    }
+
+    // Service to the right first, then to the left; do not include
+    // disk edges because LOOK stops at the last request.
+    sort(left.begin(), left.end(), greater<>());
+    sort(right.begin(), right.end());
+
+    for (int c : right) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+
+    for (int c : left) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// clook
+//
+// C-LOOK algorithm: The head moves in one direction
+// servicing requests up to the furthest request, then jumps to the
+// smallest request without traversing the unused track area.
+//
+//***********************************************************************
+int clook(vector<int> cylinders, int head_pos)
+{
+    int total_movement = 0;
+    vector<int> left, right;
+
+    for (int c : cylinders) {
+        if (c < head_pos)
+            left.push_back(c);
+        else
+            right.push_back(c);
+    }
+
+    sort(left.begin(), left.end());
+    sort(right.begin(), right.end());
+
+    // Service to the right first
+    for (int c : right) {
+        total_movement += abs(c - head_pos);
+        head_pos = c;
+    }
+
+    if (!left.empty()) {
+        // Jump from the last serviced right request (or the starting
+        // head, if there were none) to the first left request; this
+        // models the circular jump but does not include outer disk edges.
+        total_movement += abs(head_pos - left.front());
+        head_pos = left.front();
+
+        for (int c : left) {
+            total_movement += abs(c - head_pos);
+            head_pos = c;
+        }
+    }
+
+    return total_movement;
+}
+
+//***********************************************************************
+//
+// request_set
+//
+// Every elevator pass visits its requests in sorted order, so the
+// movement over a pass is just its last position minus its first and
+// only the ends of each side of the head matter: the smallest request,
+// the largest one, and the largest one left of the head. With the
+// requests sorted these are found by one binary search, so each query
+// is O(log n).
+//
+//***********************************************************************
+request_set::request_set(const vector<int>& cylinders, int disk_size)
+    : sorted_(cylinders), disk_size_(disk_size)
+{
+    sort(sorted_.begin(), sorted_.end());
+}
+
+size_t request_set::split(int head_pos) const
+{
+    return lower_bound(sorted_.begin(), sorted_.end(), head_pos) - sorted_.begin();
+}
+
+// Out to the last cylinder, then all the way back to 0, whatever the
+// requests are.
+int request_set::scan(int head_pos) const
+{
+    return 2 * (disk_size_ - 1) - head_pos;
+}
+
+// Out to the last cylinder, jump back to 0, then up to the largest
+// request left of the head.
+int request_set::cscan(int head_pos) const
+{
+    size_t k = split(head_pos);
+    int total_movement = (disk_size_ - 1 - head_pos) + (disk_size_ - 1);
+    if (k > 0) total_movement += sorted_[k - 1];
+    return total_movement;
+}
+
+// Up to the largest request, then back down to the smallest one left of
+// the head.
+int request_set::look(int head_pos) const
+{
+    size_t k = split(head_pos);
+    int turn = head_pos;
+    if (k < sorted_.size()) turn = sorted_.back();
+    int total_movement = turn - head_pos;
+    if (k > 0) total_movement += turn - sorted_.front();
+    return total_movement;
+}
+
+// Up to the largest request, jump to the smallest one, then up to the
+// largest one left of the head.
+int request_set::clook(int head_pos) const
+{
+    size_t k = split(head_pos);
+    int turn = head_pos;
+    if (k < sorted_.size()) turn = sorted_.back();
+    int total_movement = turn - head_pos;
+    if (k > 0) total_movement += (turn - sorted_.front()) + (sorted_[k - 1] - sorted_.front());
+    return total_movement;
+}
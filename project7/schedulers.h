@@ -0,0 +1,56 @@
+#ifndef _SCHEDULERS_H_DEFINED_
+#define _SCHEDULERS_H_DEFINED_
+
+#include <cstddef>
+#include <vector>
+
+// Disk scheduling algorithms. Each returns the total head movement
+// needed to service `cylinders` starting from `head_pos`.
+
+int fcfs(std::vector<int>& cylinders, int head_pos);
+
+int sstf(std::vector<int> cylinders, int head_pos, int disk_size = 3000);
+
+int scan(std::vector<int> cylinders, int head_pos, int disk_size = 3000);
+
+int cscan(std::vector<int> cylinders, int head_pos, int disk_size = 3000);
+
+int look(std::vector<int> cylinders, int head_pos);
+
+int clook(std::vector<int> cylinders, int head_pos);
+
+//***********************************************************************
+//
+// request_set
+//
+// A request list sorted once, so the elevator-family totals can be
+// answered for any starting head position with one binary search
+// instead of a partition and sort per call. Each method returns exactly
+// what the function of the same name returns for the same list and
+// head, for requests and heads in [0, disk_size).
+//
+//***********************************************************************
+class request_set {
+public:
+    explicit request_set(const std::vector<int>& cylinders, int disk_size = 3000);
+
+    int scan(int head_pos) const;
+
+    int cscan(int head_pos) const;
+
+    int look(int head_pos) const;
+
+    int clook(int head_pos) const;
+
+    size_t size() const { return sorted_.size(); }
+
+private:
+    // Index of the first request at or beyond `head_pos`; requests
+    // before it are on the left of the head.
+    size_t split(int head_pos) const;
+
+    std::vector<int> sorted_;
+    int disk_size_;
+};
+
+#endif